@@ -0,0 +1,433 @@
+#ifndef _ALLOCATOR_H_
+#define _ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//Blocks of at least this many bytes are mapped with mmap by epl::allocator
+//and grown with mremap, so a multi-gigabyte vector never has its old and new
+//block resident at once. 0 turns the mmap path off.
+#ifndef EPL_MMAP_THRESHOLD
+#define EPL_MMAP_THRESHOLD (32u << 20)
+#endif
+
+//Ask for transparent huge pages on mapped blocks.
+#ifndef EPL_MMAP_HUGEPAGES
+#define EPL_MMAP_HUGEPAGES 0
+#endif
+
+//Allocators for epl::vector. Besides the usual allocate/deallocate an
+//allocator may provide reallocate(p, old_n, new_n), which the vector uses to
+//grow a block of trivially relocatable elements without an explicit copy.
+
+namespace epl{
+
+    /*********************anonymous mappings******************************/
+    //Page-granular blocks straight from the kernel. Only used on Linux, where
+    //mremap can move or extend a mapping without copying its pages.
+    struct mapped_memory{
+#if defined(__linux__)
+        static const bool available = EPL_MMAP_THRESHOLD != 0;
+#else
+        static const bool available = false;
+#endif
+
+        static bool wanted(std::size_t bytes){
+            return available && bytes >= (std::size_t) EPL_MMAP_THRESHOLD;
+        }
+
+#if defined(__linux__)
+        static std::size_t round(std::size_t bytes){
+            static const std::size_t page = (std::size_t) sysconf(_SC_PAGESIZE);
+            return (bytes + page - 1) & ~(page - 1);
+        }
+
+        static void advise(void* p, std::size_t bytes){
+#if EPL_MMAP_HUGEPAGES && defined(MADV_HUGEPAGE)
+            madvise(p, bytes, MADV_HUGEPAGE);
+#else
+            (void) p; (void) bytes;
+#endif
+        }
+
+        static void* map(std::size_t bytes){
+            void* p = mmap(nullptr, round(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(p == MAP_FAILED) { throw std::bad_alloc{}; }
+            advise(p, round(bytes));
+            return p;
+        }
+
+        static void unmap(void* p, std::size_t bytes){
+            munmap(p, round(bytes));
+        }
+
+        static void* remap(void* p, std::size_t old_bytes, std::size_t new_bytes){
+            void* q = mremap(p, round(old_bytes), round(new_bytes), MREMAP_MAYMOVE);
+            if(q == MAP_FAILED) { throw std::bad_alloc{}; }
+            if(round(new_bytes) > round(old_bytes)) { advise(q, round(new_bytes)); }
+            return q;
+        }
+#else
+        static void* map(std::size_t) { throw std::bad_alloc{}; }
+        static void unmap(void*, std::size_t) {}
+        static void* remap(void*, std::size_t, std::size_t) { throw std::bad_alloc{}; }
+#endif
+    };
+
+
+    /*********************default allocator*********************************/
+    //malloc based so that growth can go through realloc; blocks past
+    //EPL_MMAP_THRESHOLD bytes are anonymous mappings grown with mremap
+    template <typename T>
+    class allocator{
+    public:
+        typedef T value_type;
+        template <typename U> struct rebind { typedef allocator<U> other; };
+
+        allocator(void) {}
+        template <typename U> allocator(const allocator<U>&) {}
+
+        T* allocate(std::size_t n){
+            if(mapped_memory::wanted(sizeof(T) * n)) { return static_cast<T*>(mapped_memory::map(sizeof(T) * n)); }
+            T* p = static_cast<T*>(std::malloc(sizeof(T) * n));
+            if(p == nullptr && n != 0) { throw std::bad_alloc{}; }
+            return p;
+        }
+
+        //n must be the count the block was allocated (or reallocated) with
+        void deallocate(T* p, std::size_t n){
+            if(mapped_memory::wanted(sizeof(T) * n)) { mapped_memory::unmap(p, sizeof(T) * n); }
+            else { std::free(p); }
+        }
+
+        T* reallocate(T* p, std::size_t old_n, std::size_t new_n){
+            std::size_t old_bytes = sizeof(T) * old_n, new_bytes = sizeof(T) * new_n;
+            bool old_mapped = mapped_memory::wanted(old_bytes);
+            bool new_mapped = mapped_memory::wanted(new_bytes);
+            if(old_mapped && new_mapped){
+                return static_cast<T*>(mapped_memory::remap(p, old_bytes, new_bytes));
+            }
+            if(old_mapped || new_mapped){
+                T* q = allocate(new_n);
+                std::memcpy(static_cast<void*>(q), static_cast<void*>(p), old_bytes < new_bytes ? old_bytes : new_bytes);
+                deallocate(p, old_n);
+                return q;
+            }
+            T* q = static_cast<T*>(std::realloc(static_cast<void*>(p), new_bytes));
+            if(q == nullptr && new_n != 0) { throw std::bad_alloc{}; }
+            return q;
+        }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const allocator<T>&, const allocator<U>&) { return true; }
+    template <typename T, typename U>
+    bool operator!=(const allocator<T>&, const allocator<U>&) { return false; }
+
+
+    /*********************reallocate detection******************************/
+    template <typename A, typename = void>
+    struct has_reallocate : std::false_type {};
+
+    template <typename A>
+    struct has_reallocate<A, decltype((void) std::declval<A&>().reallocate(
+            std::declval<typename A::value_type*>(), std::size_t(), std::size_t()))>
+        : std::true_type {};
+
+
+    /*********************monotonic arena***********************************/
+    //Hands out memory by bumping a pointer through large chunks. Nothing is
+    //freed individually; reset() rewinds the arena and keeps its chunks, so a
+    //per-request arena stops touching malloc once it has warmed up.
+    class monotonic_arena{
+    private:
+        struct chunk{
+            chunk* next;
+            std::size_t size;     //usable bytes after the header
+        };
+
+        chunk* first;
+        chunk* current;
+        char* cursor;
+        char* limit;
+        std::size_t chunk_size;
+        std::size_t used;
+
+        static const std::size_t header = (sizeof(chunk) + alignof(std::max_align_t) - 1)
+                                          & ~(alignof(std::max_align_t) - 1);
+
+        static char* data(chunk* c) { return reinterpret_cast<char*>(c) + header; }
+
+        static char* align_up(char* p, std::size_t align){
+            uintptr_t v = reinterpret_cast<uintptr_t>(p);
+            return reinterpret_cast<char*>((v + align - 1) & ~(uintptr_t)(align - 1));
+        }
+
+        void enter(chunk* c){
+            current = c;
+            cursor = data(c);
+            limit = cursor + c->size;
+        }
+
+        //move to the next chunk able to hold bytes, allocating one if needed
+        void advance(std::size_t bytes, std::size_t align){
+            std::size_t need = bytes + align;
+            if(current != nullptr && current->next != nullptr && current->next->size >= need){
+                enter(current->next);
+                return;
+            }
+            std::size_t size = (need > chunk_size) ? need : chunk_size;
+            chunk* c = static_cast<chunk*>(std::malloc(header + size));
+            if(c == nullptr) { throw std::bad_alloc{}; }
+            c->size = size;
+            if(current == nullptr){
+                c->next = first;
+                first = c;
+            }
+            else{
+                c->next = current->next;
+                current->next = c;
+            }
+            enter(c);
+        }
+
+    public:
+        explicit monotonic_arena(std::size_t chunk_size = 64 * 1024){
+            first = current = nullptr;
+            cursor = limit = nullptr;
+            this->chunk_size = chunk_size;
+            used = 0;
+        }
+
+        monotonic_arena(const monotonic_arena&) = delete;
+        monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+        ~monotonic_arena(void) { release(); }
+
+        void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)){
+            char* p = align_up(cursor, align);
+            if(cursor == nullptr || p + bytes > limit){
+                advance(bytes, align);
+                p = align_up(cursor, align);
+            }
+            cursor = p + bytes;
+            used += bytes;
+            return p;
+        }
+
+        //grows the most recent allocation in place when the chunk has room
+        bool extend(void* p, std::size_t old_bytes, std::size_t new_bytes){
+            char* q = static_cast<char*>(p);
+            if(q + old_bytes != cursor || q + new_bytes > limit) { return false; }
+            cursor = q + new_bytes;
+            used += new_bytes - old_bytes;
+            return true;
+        }
+
+        //rewind to the first chunk; every pointer handed out becomes invalid
+        void reset(void){
+            used = 0;
+            if(first != nullptr) { enter(first); }
+        }
+
+        //return every chunk to the system
+        void release(void){
+            while(first != nullptr){
+                chunk* next = first->next;
+                std::free(first);
+                first = next;
+            }
+            current = nullptr;
+            cursor = limit = nullptr;
+            used = 0;
+        }
+
+        std::size_t bytes_used(void) const { return used; }
+    };
+
+    template <typename T>
+    class arena_allocator{
+    private:
+        monotonic_arena* arena;
+
+        template <typename U> friend class arena_allocator;
+
+    public:
+        typedef T value_type;
+        template <typename U> struct rebind { typedef arena_allocator<U> other; };
+
+        arena_allocator(monotonic_arena& arena) { this->arena = &arena; }
+        template <typename U> arena_allocator(const arena_allocator<U>& that) { arena = that.arena; }
+
+        T* allocate(std::size_t n){
+            return static_cast<T*>(arena->allocate(sizeof(T) * n, alignof(T)));
+        }
+
+        void deallocate(T*, std::size_t) {}
+
+        T* reallocate(T* p, std::size_t old_n, std::size_t new_n){
+            if(arena->extend(p, sizeof(T) * old_n, sizeof(T) * new_n)) { return p; }
+            T* q = allocate(new_n);
+            std::memcpy(static_cast<void*>(q), static_cast<void*>(p), sizeof(T) * (old_n < new_n ? old_n : new_n));
+            return q;
+        }
+
+        monotonic_arena& resource(void) const { return *arena; }
+
+        template <typename U>
+        bool operator==(const arena_allocator<U>& that) const { return arena == that.arena; }
+        template <typename U>
+        bool operator!=(const arena_allocator<U>& that) const { return arena != that.arena; }
+    };
+
+
+    /*********************size-class pool***********************************/
+    //Power-of-two size classes from 16 bytes to max_class bytes, each with
+    //its own free list, carved out of large slabs. Larger requests go
+    //straight to malloc. Blocks are recycled, never returned to the system
+    //before the pool is destroyed.
+    class pool_resource{
+    public:
+        static const std::size_t min_class = 16;
+        static const std::size_t max_class = 64 * 1024;
+        static const int class_count = 13;     //16 << 12 == 64K
+
+    private:
+        struct node { node* next; };
+
+        node* free_lists[class_count];
+        node* slabs;
+        char* cursor;
+        char* limit;
+        std::size_t slab_size;
+
+        static const std::size_t header = (sizeof(node) + alignof(std::max_align_t) - 1)
+                                          & ~(alignof(std::max_align_t) - 1);
+
+        static int size_class(std::size_t bytes){
+            int c = 0;
+            std::size_t size = min_class;
+            while(size < bytes) { size <<= 1; c++; }
+            return c;
+        }
+
+        char* carve(std::size_t size){
+            if(cursor == nullptr || cursor + size > limit){
+                std::size_t bytes = (size > slab_size) ? size : slab_size;
+                node* slab = static_cast<node*>(std::malloc(header + bytes));
+                if(slab == nullptr) { throw std::bad_alloc{}; }
+                slab->next = slabs;
+                slabs = slab;
+                cursor = reinterpret_cast<char*>(slab) + header;
+                limit = cursor + bytes;
+            }
+            char* p = cursor;
+            cursor += size;
+            return p;
+        }
+
+    public:
+        explicit pool_resource(std::size_t slab_size = 256 * 1024){
+            for(int c = 0; c < class_count; c++) { free_lists[c] = nullptr; }
+            slabs = nullptr;
+            cursor = limit = nullptr;
+            this->slab_size = slab_size;
+        }
+
+        pool_resource(const pool_resource&) = delete;
+        pool_resource& operator=(const pool_resource&) = delete;
+
+        ~pool_resource(void){
+            while(slabs != nullptr){
+                node* next = slabs->next;
+                std::free(slabs);
+                slabs = next;
+            }
+        }
+
+        static std::size_t class_size(std::size_t bytes){
+            return (bytes > max_class) ? bytes : (min_class << size_class(bytes));
+        }
+
+        void* allocate(std::size_t bytes){
+            if(bytes > max_class){
+                void* p = std::malloc(bytes);
+                if(p == nullptr) { throw std::bad_alloc{}; }
+                return p;
+            }
+            int c = size_class(bytes);
+            node* n = free_lists[c];
+            if(n != nullptr){
+                free_lists[c] = n->next;
+                return n;
+            }
+            return carve(min_class << c);
+        }
+
+        void deallocate(void* p, std::size_t bytes){
+            if(p == nullptr) { return; }
+            if(bytes > max_class){
+                std::free(p);
+                return;
+            }
+            int c = size_class(bytes);
+            node* n = static_cast<node*>(p);
+            n->next = free_lists[c];
+            free_lists[c] = n;
+        }
+    };
+
+    template <typename T>
+    class pool_allocator{
+    private:
+        pool_resource* pool;
+
+        template <typename U> friend class pool_allocator;
+
+    public:
+        typedef T value_type;
+        template <typename U> struct rebind { typedef pool_allocator<U> other; };
+
+        pool_allocator(pool_resource& pool) { this->pool = &pool; }
+        template <typename U> pool_allocator(const pool_allocator<U>& that) { pool = that.pool; }
+
+        T* allocate(std::size_t n){
+            return static_cast<T*>(pool->allocate(sizeof(T) * n));
+        }
+
+        void deallocate(T* p, std::size_t n){
+            pool->deallocate(p, sizeof(T) * n);
+        }
+
+        T* reallocate(T* p, std::size_t old_n, std::size_t new_n){
+            //the block is kept only when it stays in its class, since
+            //deallocate files it under the class of the size it is given
+            if(sizeof(T) * old_n <= pool_resource::max_class && sizeof(T) * new_n <= pool_resource::max_class
+                && pool_resource::class_size(sizeof(T) * old_n) == pool_resource::class_size(sizeof(T) * new_n)) { return p; }
+            T* q = allocate(new_n);
+            std::memcpy(static_cast<void*>(q), static_cast<void*>(p), sizeof(T) * (old_n < new_n ? old_n : new_n));
+            deallocate(p, old_n);
+            return q;
+        }
+
+        pool_resource& resource(void) const { return *pool; }
+
+        template <typename U>
+        bool operator==(const pool_allocator<U>& that) const { return pool == that.pool; }
+        template <typename U>
+        bool operator!=(const pool_allocator<U>& that) const { return pool != that.pool; }
+    };
+
+} //namespace epl
+
+#endif
@@ -0,0 +1,433 @@
+#ifndef _BIT_VECTOR_H_
+#define _BIT_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+namespace bits_detail{
+
+    inline uint64_t popcount(uint64_t w) { return __builtin_popcountll(w); }
+
+    //the bits [0, n) of a word, for n in [0, 64]
+    inline uint64_t low_mask(uint64_t n) { return (n >= 64) ? ~uint64_t(0) : (uint64_t(1) << n) - 1; }
+
+    //the position of the k-th set bit of w (k < popcount(w)), found by
+    //halving the word six times
+    inline uint64_t select_in_word(uint64_t w, uint64_t k){
+        uint64_t pos = 0;
+        for(uint64_t s = 32; s != 0; s >>= 1){
+            uint64_t c = popcount(w & low_mask(s));
+            if(k >= c){
+                k -= c;
+                w >>= s;
+                pos += s;
+            }
+        }
+        return pos;
+    }
+
+} //namespace bits_detail
+
+    //A double-ended sequence of bits, 64 to a word, kept in an
+    //epl::vector<uint64_t>. push_front fills the first word downwards and,
+    //once it is full, pushes a new word onto the front of the vector, so
+    //both ends grow the way an epl::vector does. Bits outside [0, size())
+    //are always zero, which lets count() and rank() add up whole words.
+    //
+    //rank(i) and select(k) use a directory of running counts, one per 512
+    //bits, which is rebuilt by the first of them after the bits change;
+    //call build_rank_index() before sharing the vector with concurrent
+    //readers.
+    template <typename Alloc = allocator<uint64_t> >
+    class bit_vector{
+    private:
+        static constexpr uint64_t block_words = 8;
+
+        vector<uint64_t, Alloc> words;
+        uint64_t head;              //unused bits below the first one in words[0]
+        uint64_t length;
+        uint64_t front_version;     //bumped when indexes shift (front push/pop)
+        mutable vector<uint64_t, Alloc> counts;    //counts[j]: set bits in words[0, 8j)
+        mutable bool stale;
+
+        const uint64_t* word_data(void) const { return static_cast<const vector<uint64_t, Alloc>&>(words).data(); }
+
+        void init(void){
+            head = 0;
+            length = 0;
+            front_version = 0;
+            stale = true;
+        }
+
+        void check_range(uint64_t first, uint64_t last) const{
+            if(first > last || last > length) { throw std::out_of_range{"range out of range"}; }
+        }
+
+        //calls f(word, mask) for each word holding bits of [first, last)
+        template <typename F>
+        void for_each_word(uint64_t first, uint64_t last, F f){
+            if(first == last) { return; }
+            uint64_t p = head + first, q = head + last;
+            uint64_t* w = words.data();
+            uint64_t i = p / 64, j = (q - 1) / 64;
+            uint64_t lo = ~bits_detail::low_mask(p % 64);
+            uint64_t hi = bits_detail::low_mask(q - j * 64);
+            if(i == j){
+                f(w[i], lo & hi);
+                return;
+            }
+            f(w[i], lo);
+            for(uint64_t k = i + 1; k < j; k++) { f(w[k], ~uint64_t(0)); }
+            f(w[j], hi);
+        }
+
+        void index_blocks(void) const{
+            if(!stale) { return; }
+            const uint64_t* w = word_data();
+            uint64_t n = words.size(), total = 0;
+            counts.clear();
+            counts.reserve(n / block_words + 1);
+            for(uint64_t k = 0; k < n; k++){
+                if(k % block_words == 0) { counts.push_back(total); }
+                total += bits_detail::popcount(w[k]);
+            }
+            counts.push_back(total);
+            stale = false;
+        }
+
+    public:
+        typedef bool value_type;
+        typedef Alloc allocator_type;
+
+        //a writable bit: converts to bool and assigns through to the word
+        class reference{
+        private:
+            uint64_t* word;
+            uint64_t mask;
+            bool* stale;
+
+            friend class bit_vector;
+            reference(uint64_t* word, uint64_t mask, bool* stale) { this->word = word; this->mask = mask; this->stale = stale; }
+
+        public:
+            operator bool(void) const { return (*word & mask) != 0; }
+
+            reference& operator=(bool b){
+                *word = b ? (*word | mask) : (*word & ~mask);
+                *stale = true;
+                return *this;
+            }
+
+            reference& operator=(const reference& that) { return *this = bool(that); }
+
+            void flip(void){
+                *word ^= mask;
+                *stale = true;
+            }
+        };
+
+        bit_vector(void) { init(); }
+
+        explicit bit_vector(const Alloc& a) : words(a), counts(a) { init(); }
+
+        explicit bit_vector(uint64_t n, bool b = false, const Alloc& a = Alloc()) : words(a), counts(a) {
+            init();
+            resize(n, b);
+        }
+
+        bit_vector(std::initializer_list<bool> i1, const Alloc& a = Alloc()) : words(a), counts(a) {
+            init();
+            words.reserve((i1.size() + 63) / 64);
+            for(auto iter = i1.begin(); iter != i1.end(); ++iter) { push_back(*iter); }
+        }
+
+        template<typename IT>
+        bit_vector(IT b, IT e, const Alloc& a = Alloc()) : words(a), counts(a) {
+            init();
+            for(; b != e; ++b) { push_back(*b); }
+        }
+
+        bit_vector(const bit_vector& that) : words(that.words), counts(that.words.get_allocator()) {
+            head = that.head; length = that.length;
+            front_version = 0;
+            stale = true;
+        }
+
+        bit_vector(bit_vector&& that) noexcept : words(std::move(that.words)), counts(std::move(that.counts)) {
+            head = that.head; length = that.length; stale = that.stale;
+            front_version = 0;
+            that.init();
+        }
+
+        bit_vector& operator=(const bit_vector& that){
+            if(this != &that){
+                words = that.words;
+                head = that.head; length = that.length;
+                stale = true;
+            }
+            front_version++;
+            return *this;
+        }
+
+        bit_vector& operator=(bit_vector&& that) noexcept{
+            if(this != &that){
+                words = std::move(that.words);
+                counts = std::move(that.counts);
+                head = that.head; length = that.length; stale = that.stale;
+                that.init();
+            }
+            front_version++;
+            return *this;
+        }
+
+        uint64_t size(void) const { return length; }
+        bool empty(void) const { return length == 0; }
+
+        //bytes of element storage in use, without the slack
+        uint64_t bytes(void) const { return words.size() * sizeof(uint64_t); }
+
+        void reserve(uint64_t n) { words.reserve((head + n + 63) / 64); }
+
+        bool test(uint64_t k) const{
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            uint64_t p = head + k;
+            return (word_data()[p / 64] >> (p % 64)) & 1;
+        }
+
+        bool operator[](uint64_t k) const { return test(k); }
+
+        reference operator[](uint64_t k){
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            uint64_t p = head + k;
+            return reference(words.data() + p / 64, uint64_t(1) << (p % 64), &stale);
+        }
+
+        void set(uint64_t k, bool b = true) { (*this)[k] = b; }
+        void reset(uint64_t k) { (*this)[k] = false; }
+        void flip(uint64_t k) { (*this)[k].flip(); }
+
+        /**********************bulk operations*********************************/
+        //sets every bit of [first, last) to b, a word at a time
+        void set(uint64_t first, uint64_t last, bool b){
+            check_range(first, last);
+            if(b) { for_each_word(first, last, [](uint64_t& w, uint64_t m) { w |= m; }); }
+            else { for_each_word(first, last, [](uint64_t& w, uint64_t m) { w &= ~m; }); }
+            stale = true;
+        }
+
+        void reset(uint64_t first, uint64_t last) { set(first, last, false); }
+
+        void flip(uint64_t first, uint64_t last){
+            check_range(first, last);
+            for_each_word(first, last, [](uint64_t& w, uint64_t m) { w ^= m; });
+            stale = true;
+        }
+
+        //grows or shrinks to n bits at the back; new bits are b
+        void resize(uint64_t n, bool b = false){
+            while(length > n) { pop_back(); }
+            if(n == length) { return; }
+            uint64_t first = length;
+            if(words.empty()) { head = 0; }
+            uint64_t need = (head + n + 63) / 64;
+            words.reserve(need);
+            while(words.size() < need) { words.push_back(0); }
+            length = n;
+            if(b) { set(first, n, true); }
+            stale = true;
+        }
+
+        //the number of set bits
+        uint64_t count(void) const{
+            const uint64_t* w = word_data();
+            uint64_t total = 0;
+            for(uint64_t k = 0; k < words.size(); k++) { total += bits_detail::popcount(w[k]); }
+            return total;
+        }
+
+        //the number of set bits in [0, k), for k <= size()
+        uint64_t rank(uint64_t k) const{
+            if(k > length) { throw std::out_of_range{"subscript out of range"}; }
+            index_blocks();
+            const uint64_t* w = word_data();
+            uint64_t p = head + k;
+            uint64_t i = p / 64;
+            uint64_t total = static_cast<const vector<uint64_t, Alloc>&>(counts)[i / block_words];
+            for(uint64_t j = i - i % block_words; j < i; j++) { total += bits_detail::popcount(w[j]); }
+            if(p % 64 != 0) { total += bits_detail::popcount(w[i] & bits_detail::low_mask(p % 64)); }
+            return total;
+        }
+
+        //the index of the k-th set bit, counting from 0
+        uint64_t select(uint64_t k) const{
+            index_blocks();
+            const uint64_t* c = static_cast<const vector<uint64_t, Alloc>&>(counts).data();
+            uint64_t blocks = counts.size() - 1;
+            if(k >= c[blocks]) { throw std::out_of_range{"fewer set bits than asked for"}; }
+            //the last block whose running count is at most k
+            uint64_t lo = 0, hi = blocks;
+            while(hi - lo > 1){
+                uint64_t mid = (lo + hi) / 2;
+                if(c[mid] <= k) { lo = mid; }
+                else { hi = mid; }
+            }
+            const uint64_t* w = word_data();
+            k -= c[lo];
+            uint64_t i = lo * block_words;
+            for(;; i++){
+                uint64_t n = bits_detail::popcount(w[i]);
+                if(k < n) { break; }
+                k -= n;
+            }
+            return i * 64 + bits_detail::select_in_word(w[i], k) - head;
+        }
+
+        //makes the next rank() or select() free of the directory rebuild
+        void build_rank_index(void) const { index_blocks(); }
+
+        /**********************push and pop*********************************/
+        void push_back(bool b){
+            uint64_t p = head + length;
+            if(p % 64 == 0 && p / 64 == words.size()) { words.push_back(0); }
+            if(b) { words.data()[p / 64] |= uint64_t(1) << (p % 64); }
+            length++;
+            stale = true;
+        }
+
+        void push_front(bool b){
+            if(words.empty()) { words.push_back(0); head = 64; }
+            else if(head == 0) { words.push_front(0); head = 64; }
+            head--;
+            if(b) { words.data()[0] |= uint64_t(1) << head; }
+            length++;
+            front_version++;
+            stale = true;
+        }
+
+        void pop_back(void){
+            if(length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            length--;
+            uint64_t p = head + length;
+            words.data()[p / 64] &= ~(uint64_t(1) << (p % 64));
+            if(length == 0) { words.clear(); head = 0; }
+            else if(p % 64 == 0) { words.pop_back(); }
+            stale = true;
+        }
+
+        void pop_front(void){
+            if(length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            words.data()[0] &= ~(uint64_t(1) << head);
+            head++;
+            length--;
+            if(length == 0) { words.clear(); head = 0; }
+            else if(head == 64) { words.pop_front(); head = 0; }
+            front_version++;
+            stale = true;
+        }
+
+        void clear(void){
+            words.clear();
+            head = 0;
+            length = 0;
+            front_version++;
+            stale = true;
+        }
+
+        /**********************iterator class*********************************/
+        //An index into the bits. Pushing at the back never invalidates it;
+        //pushing or popping at the front shifts every index, which a checked
+        //iterator reports as a MILD invalid_iterator.
+        template <bool Const>
+        class basic_iterator{
+        private:
+            typedef typename std::conditional<Const, const bit_vector, bit_vector>::type container;
+            container* parent;
+            int64_t index;
+#if EPL_CHECKED_ITERATORS
+            uint64_t iterator_version;
+#endif
+
+            friend class bit_vector;
+            template <bool> friend class basic_iterator;
+
+        public:
+            typedef bool value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef void pointer;
+            typedef typename std::conditional<Const, bool, typename bit_vector::reference>::type reference;
+
+            basic_iterator(void) { parent = nullptr; index = 0; set_version(); }
+
+            basic_iterator(container* parent, int64_t index){
+                this->parent = parent;
+                this->index = index;
+                set_version();
+            }
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            basic_iterator(const basic_iterator<C>& it){
+                parent = it.parent;
+                index = it.index;
+#if EPL_CHECKED_ITERATORS
+                iterator_version = it.iterator_version;
+#endif
+            }
+
+            reference operator*(void) const { check_exception(); return (*parent)[index]; }
+            reference operator[](int64_t k) const { check_exception(); return (*parent)[index + k]; }
+
+            basic_iterator& operator++() { index++; return *this; }
+            basic_iterator operator++(int) { basic_iterator tmp{*this}; index++; return tmp; }
+            basic_iterator& operator--() { index--; return *this; }
+            basic_iterator operator--(int) { basic_iterator tmp{*this}; index--; return tmp; }
+
+            basic_iterator& operator+=(int64_t k) { index += k; return *this; }
+            basic_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            basic_iterator operator+(int64_t k) const { basic_iterator tmp{*this}; tmp.index += k; return tmp; }
+            basic_iterator operator-(int64_t k) const { basic_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            int64_t operator-(const basic_iterator& it) const { return index - it.index; }
+
+            bool operator==(const basic_iterator& it) const { check_exception(); return index == it.index; }
+            bool operator!=(const basic_iterator& it) const { return !(*this == it); }
+            bool operator<(const basic_iterator& it) const { return index < it.index; }
+            bool operator>(const basic_iterator& it) const { return index > it.index; }
+            bool operator<=(const basic_iterator& it) const { return index <= it.index; }
+            bool operator>=(const basic_iterator& it) const { return index >= it.index; }
+
+#if EPL_CHECKED_ITERATORS
+            void set_version(void) { iterator_version = parent ? parent->front_version : 0; }
+
+            void check_exception() const{
+                if(parent != nullptr && iterator_version != parent->front_version)
+                    throw epl::invalid_iterator{    epl::invalid_iterator::MILD  };
+            }
+#else
+            void set_version(void) {}
+            void check_exception() const {}
+#endif
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        iterator begin(void) { return iterator(this, 0); }
+        iterator end(void) { return iterator(this, length); }
+        const_iterator begin(void) const { return const_iterator(this, 0); }
+        const_iterator end(void) const { return const_iterator(this, length); }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
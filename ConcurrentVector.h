@@ -0,0 +1,276 @@
+#ifndef _CONCURRENT_VECTOR_H_
+#define _CONCURRENT_VECTOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "SegmentedVector.h"
+
+namespace epl{
+
+    //An append-only vector for many producer threads. push_back, emplace_back
+    //and grow_by claim their slots with one atomic fetch_add and never take a
+    //lock. Storage is a table of segments that double in size (F, 2F, 4F, ...)
+    //and are never moved or freed while the vector lives, so a reader holding
+    //an index or a reference is never disturbed by concurrent appends.
+    //
+    //Each slot has a ready flag that is set (with release order) once its
+    //element is constructed. size() counts claimed slots, which may still be
+    //under construction; at() and ready() look at the flag, so an indexed
+    //read is safe at any time. ready_size() is the length of the prefix of
+    //slots that are all ready, and iteration covers that prefix, so every
+    //index below it may be read through operator[] or an iterator while
+    //other threads append. clear(), copying, assignment and destruction
+    //must not run concurrently with anything else. Alloc is called from
+    //the appending threads and must be safe to share between them.
+    template <typename T, typename Alloc = allocator<T>, uint64_t F = segment_size<T>::value>
+    class concurrent_vector{
+    private:
+        static_assert(F != 0 && (F & (F - 1)) == 0, "first segment size must be a power of two");
+
+        static const int max_segments = 48;
+
+        struct segment{
+            T* items;
+            std::atomic<uint8_t>* ready;
+        };
+
+        std::atomic<segment*> segments[max_segments];
+        std::atomic<uint64_t> claimed;
+        mutable std::atomic<uint64_t> published;    //a known ready prefix, only ever raised
+        Alloc alloc;
+
+        static uint64_t segment_of(uint64_t i){
+            uint64_t q = i / F + 1;
+            return 63 - __builtin_clzll(q);
+        }
+
+        static uint64_t segment_base(uint64_t k) { return F * ((uint64_t(1) << k) - 1); }
+        static uint64_t segment_length(uint64_t k) { return F << k; }
+
+        //The segment, allocating it if no thread has yet. Every thread that
+        //finds it missing allocates one and tries to install it; the losers
+        //free theirs and use the winner's, so nobody waits on another
+        //thread's allocation. Threads that cross into a new segment together
+        //may each allocate it once; the extra blocks are freed at once.
+        segment* acquire_segment(uint64_t k){
+            segment* s = segments[k].load(std::memory_order_acquire);
+            if(s != nullptr) { return s; }
+            uint64_t n = segment_length(k);
+            segment* fresh = new segment;
+            try{
+                fresh->items = alloc.allocate(n);
+                try { fresh->ready = new std::atomic<uint8_t>[n]; }
+                catch(...) { alloc.deallocate(fresh->items, n); throw; }
+            }
+            catch(...) { delete fresh; throw; }
+            for(uint64_t j = 0; j < n; j++) { fresh->ready[j].store(0, std::memory_order_relaxed); }
+            if(segments[k].compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) { return fresh; }
+            free_segment(fresh, k);
+            return s;
+        }
+
+        void free_segment(segment* s, uint64_t k){
+            alloc.deallocate(s->items, segment_length(k));
+            delete[] s->ready;
+            delete s;
+        }
+
+        //construct the element of slot i from args and publish it
+        template <typename... Args>
+        void construct(uint64_t i, Args&&... args){
+            uint64_t k = segment_of(i);
+            segment* s = acquire_segment(k);
+            uint64_t j = i - segment_base(k);
+            new(s->items + j) T(std::forward<Args>(args)...);
+            s->ready[j].store(1, std::memory_order_release);
+        }
+
+        T* slot(uint64_t i) const{
+            uint64_t k = segment_of(i);
+            return segments[k].load(std::memory_order_acquire)->items + (i - segment_base(k));
+        }
+
+        void init(void){
+            for(int k = 0; k < max_segments; k++) { segments[k].store(nullptr, std::memory_order_relaxed); }
+            claimed.store(0, std::memory_order_relaxed);
+            published.store(0, std::memory_order_relaxed);
+        }
+
+    public:
+        typedef T value_type;
+        typedef Alloc allocator_type;
+
+        concurrent_vector(void) { init(); }
+
+        explicit concurrent_vector(const Alloc& a) : alloc(a) { init(); }
+
+        concurrent_vector(const concurrent_vector& that) : alloc(that.alloc) {
+            init();
+            uint64_t n = that.size();
+            for(uint64_t i = 0; i < n; i++){
+                if(that.ready(i)) { push_back(*that.slot(i)); }
+            }
+        }
+
+        concurrent_vector& operator=(const concurrent_vector& that){
+            if(this != &that){
+                clear();
+                uint64_t n = that.size();
+                for(uint64_t i = 0; i < n; i++){
+                    if(that.ready(i)) { push_back(*that.slot(i)); }
+                }
+            }
+            return *this;
+        }
+
+        ~concurrent_vector(void) { clear(); }
+
+        //claimed slots; the newest ones may still be under construction
+        uint64_t size(void) const { return claimed.load(std::memory_order_acquire); }
+        bool empty(void) const { return size() == 0; }
+
+        //appends and returns the index of the new element
+        uint64_t push_back(const T& that) { return emplace_back(that); }
+        uint64_t push_back(T&& that) { return emplace_back(std::move(that)); }
+
+        template <typename... Args>
+        uint64_t emplace_back(Args&&... args){
+            uint64_t i = claimed.fetch_add(1, std::memory_order_relaxed);
+            construct(i, std::forward<Args>(args)...);
+            return i;
+        }
+
+        //appends n copies of value and returns the index of the first
+        uint64_t grow_by(uint64_t n, const T& value = T()){
+            uint64_t first = claimed.fetch_add(n, std::memory_order_relaxed);
+            for(uint64_t i = first; i < first + n; i++) { construct(i, value); }
+            return first;
+        }
+
+        //appends [b, e) and returns the index of the first
+        template <typename IT, typename = typename std::iterator_traits<IT>::iterator_category>
+        uint64_t grow_by(IT b, IT e){
+            uint64_t n = std::distance(b, e);
+            uint64_t first = claimed.fetch_add(n, std::memory_order_relaxed);
+            for(uint64_t i = first; b != e; ++b, ++i) { construct(i, *b); }
+            return first;
+        }
+
+        //whether element i has been constructed and may be read
+        bool ready(uint64_t i) const{
+            if(i >= size()) { return false; }
+            uint64_t k = segment_of(i);
+            segment* s = segments[k].load(std::memory_order_acquire);
+            return s != nullptr && s->ready[i - segment_base(k)].load(std::memory_order_acquire) != 0;
+        }
+
+        //Slots [0, ready_size()) are all constructed. The scan starts at the
+        //last prefix found, so over the vector's life each slot is tested
+        //about once, whatever the number of callers.
+        uint64_t ready_size(void) const{
+            uint64_t n = published.load(std::memory_order_acquire);
+            uint64_t i = n;
+            while(ready(i)) { i++; }
+            while(i > n && !published.compare_exchange_weak(n, i, std::memory_order_acq_rel)) {}
+            return i > n ? i : n;
+        }
+
+        //unchecked: i must be ready (below ready_size(), or its push_back has returned)
+        T& operator[](uint64_t i) { return *slot(i); }
+        const T& operator[](uint64_t i) const { return *slot(i); }
+
+        T& at(uint64_t i){
+            if(!ready(i)) { throw std::out_of_range{"element not available"}; }
+            return *slot(i);
+        }
+
+        const T& at(uint64_t i) const{
+            if(!ready(i)) { throw std::out_of_range{"element not available"}; }
+            return *slot(i);
+        }
+
+        void clear(void){
+            uint64_t n = claimed.load(std::memory_order_acquire);
+            for(int k = 0; k < max_segments; k++){
+                segment* s = segments[k].load(std::memory_order_acquire);
+                if(s == nullptr) { continue; }
+                uint64_t base = segment_base(k);
+                uint64_t len = segment_length(k);
+                for(uint64_t j = 0; j < len && base + j < n; j++){
+                    if(s->ready[j].load(std::memory_order_relaxed)) { s->items[j].~T(); }
+                }
+                free_segment(s, k);
+                segments[k].store(nullptr, std::memory_order_relaxed);
+            }
+            claimed.store(0, std::memory_order_relaxed);
+            published.store(0, std::memory_order_release);
+        }
+
+        /**********************iterator class*********************************/
+        //Walks indexes [0, ready_size()) as of end(), so every element it
+        //reaches is constructed. Segments never move, so an iterator stays
+        //usable while other threads append; their new elements are seen by
+        //a later end().
+        template <bool Const>
+        class basic_iterator{
+        private:
+            typedef typename std::conditional<Const, const concurrent_vector, concurrent_vector>::type container;
+            container* parent;
+            int64_t index;
+
+            template <bool> friend class basic_iterator;
+
+        public:
+            typedef T value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<Const, const T*, T*>::type pointer;
+            typedef typename std::conditional<Const, const T&, T&>::type reference;
+
+            basic_iterator(void) { parent = nullptr; index = 0; }
+            basic_iterator(container* parent, int64_t index) { this->parent = parent; this->index = index; }
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            basic_iterator(const basic_iterator<C>& it) { parent = it.parent; index = it.index; }
+
+            reference operator*(void) const { return *parent->slot(index); }
+            pointer operator->(void) const { return parent->slot(index); }
+            reference operator[](int64_t k) const { return *parent->slot(index + k); }
+
+            basic_iterator& operator++() { index++; return *this; }
+            basic_iterator operator++(int) { basic_iterator tmp{*this}; index++; return tmp; }
+            basic_iterator& operator--() { index--; return *this; }
+            basic_iterator operator--(int) { basic_iterator tmp{*this}; index--; return tmp; }
+
+            basic_iterator& operator+=(int64_t k) { index += k; return *this; }
+            basic_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            basic_iterator operator+(int64_t k) const { basic_iterator tmp{*this}; tmp.index += k; return tmp; }
+            basic_iterator operator-(int64_t k) const { basic_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            int64_t operator-(const basic_iterator& it) const { return index - it.index; }
+
+            bool operator==(const basic_iterator& it) const { return index == it.index; }
+            bool operator!=(const basic_iterator& it) const { return index != it.index; }
+            bool operator<(const basic_iterator& it) const { return index < it.index; }
+            bool operator>(const basic_iterator& it) const { return index > it.index; }
+            bool operator<=(const basic_iterator& it) const { return index <= it.index; }
+            bool operator>=(const basic_iterator& it) const { return index >= it.index; }
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        iterator begin(void) { return iterator(this, 0); }
+        iterator end(void) { return iterator(this, ready_size()); }
+        const_iterator begin(void) const { return const_iterator(this, 0); }
+        const_iterator end(void) const { return const_iterator(this, ready_size()); }
+    };
+
+} //namespace epl
+
+#endif
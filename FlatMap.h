@@ -0,0 +1,385 @@
+#ifndef _FLAT_MAP_H_
+#define _FLAT_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "FlatSet.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //A map with unique keys kept sorted in two parallel epl::vectors, one of
+    //keys and one of values, so that a lookup scans nothing but keys.
+    //Iterating yields std::pair<const Key&, T&>. Lookup, single inserts and
+    //the batched insert(first, last) work as in flat_set; in a batch the
+    //entries are sorted on their own and then appended, prepended or merged
+    //with the map in one pass. Existing keys keep their values, and for
+    //keys repeated in a batch the earliest entry wins.
+    template <typename Key, typename T, typename Compare = std::less<Key>, typename Lookup = branchless_lookup,
+              typename Alloc = allocator<std::pair<const Key, T> > >
+    class flat_map{
+    private:
+        typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Key> key_allocator;
+        typedef typename std::allocator_traits<Alloc>::template rebind_alloc<T> value_allocator;
+        typedef typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<Key, T> > entry_allocator;
+
+        vector<Key, key_allocator> key_list;
+        vector<T, value_allocator> value_list;
+        Compare comp;
+        mutable flat_detail::index<Lookup, Key, Compare> search;
+        uint64_t version;       //bumped by every insert and erase, which shift indexes
+
+        const Key* key_data(void) const { return static_cast<const vector<Key, key_allocator>&>(key_list).data(); }
+        const T* value_data(void) const { return static_cast<const vector<T, value_allocator>&>(value_list).data(); }
+
+        //as in flat_set: at is set to the key at the returned index, or nullptr
+        uint64_t position(const Key& k, const Key*& at) const { return search.lower_bound(key_data(), key_list.size(), k, comp, at); }
+
+        uint64_t position(const Key& k) const{
+            const Key* at;
+            return position(k, at);
+        }
+
+        bool found(const Key* at, const Key& k) const { return at != nullptr && !comp(k, *at); }
+
+        void changed(void){
+            search.invalidate();
+            version++;
+        }
+
+        //puts an entry at pos, keeping the two vectors in step
+        template <typename K, typename... Args>
+        void insert_entry(uint64_t pos, K&& k, Args&&... args){
+            flat_detail::insert_at(key_list, pos, std::forward<K>(k));
+            try { flat_detail::insert_at(value_list, pos, T(std::forward<Args>(args)...)); }
+            catch(...) { flat_detail::erase_at(key_list, pos); throw; }
+            changed();
+        }
+
+        template <typename K, typename... Args>
+        std::pair<uint64_t, bool> try_insert(K&& k, Args&&... args){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            if(found(at, k)) { return std::make_pair(pos, false); }
+            insert_entry(pos, std::forward<K>(k), std::forward<Args>(args)...);
+            return std::make_pair(pos, true);
+        }
+
+        struct key_less{
+            const Compare* comp;
+            bool operator()(const std::pair<Key, T>& a, const std::pair<Key, T>& b) const { return (*comp)(a.first, b.first); }
+        };
+
+    public:
+        typedef Key key_type;
+        typedef T mapped_type;
+        typedef Compare key_compare;
+
+        flat_map(void) { version = 0; }
+
+        explicit flat_map(const Compare& c, const Alloc& a = Alloc())
+            : key_list(key_allocator(a)), value_list(value_allocator(a)), comp(c) { version = 0; }
+
+        flat_map(std::initializer_list<std::pair<Key, T> > i1, const Compare& c = Compare(), const Alloc& a = Alloc())
+            : key_list(key_allocator(a)), value_list(value_allocator(a)), comp(c) {
+            version = 0;
+            insert(i1.begin(), i1.end());
+        }
+
+        template <typename IT>
+        flat_map(IT b, IT e, const Compare& c = Compare(), const Alloc& a = Alloc())
+            : key_list(key_allocator(a)), value_list(value_allocator(a)), comp(c) {
+            version = 0;
+            insert(b, e);
+        }
+
+        uint64_t size(void) const { return key_list.size(); }
+        bool empty(void) const { return key_list.empty(); }
+
+        void reserve(uint64_t n){
+            key_list.reserve(n);
+            value_list.reserve(n);
+        }
+
+        void clear(void){
+            key_list.clear();
+            value_list.clear();
+            changed();
+        }
+
+        //the keys and the values in key order, each one contiguous array
+        const vector<Key, key_allocator>& keys(void) const { return key_list; }
+        const vector<T, value_allocator>& values(void) const { return value_list; }
+
+        /**********************iterator class*********************************/
+        //An index into the map. Inserts and erases shift indexes, which a
+        //checked iterator reports as a MILD invalid_iterator.
+        template <bool Const>
+        class basic_iterator{
+        private:
+            typedef typename std::conditional<Const, const flat_map, flat_map>::type container;
+            typedef typename std::conditional<Const, const T, T>::type mapped;
+            container* parent;
+            int64_t index;
+#if EPL_CHECKED_ITERATORS
+            uint64_t iterator_version;
+#endif
+
+            friend class flat_map;
+            template <bool> friend class basic_iterator;
+
+            mapped& value(int64_t i) const { return const_cast<mapped*>(parent->value_data())[i]; }
+
+        public:
+            typedef std::pair<const Key&, mapped&> value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef value_type reference;
+
+            //what operator-> points at: the pair of references itself
+            struct pointer{
+                reference entry;
+                const reference* operator->(void) const { return &entry; }
+            };
+
+            basic_iterator(void) { parent = nullptr; index = 0; set_version(); }
+
+            basic_iterator(container* parent, int64_t index){
+                this->parent = parent;
+                this->index = index;
+                set_version();
+            }
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            basic_iterator(const basic_iterator<C>& it){
+                parent = it.parent;
+                index = it.index;
+#if EPL_CHECKED_ITERATORS
+                iterator_version = it.iterator_version;
+#endif
+            }
+
+            reference operator*(void) const { check_exception(); return reference(parent->key_data()[index], value(index)); }
+            pointer operator->(void) const { check_exception(); return pointer{**this}; }
+            reference operator[](int64_t k) const { check_exception(); return reference(parent->key_data()[index + k], value(index + k)); }
+
+            const Key& key(void) const { check_exception(); return parent->key_data()[index]; }
+
+            basic_iterator& operator++() { index++; return *this; }
+            basic_iterator operator++(int) { basic_iterator tmp{*this}; index++; return tmp; }
+            basic_iterator& operator--() { index--; return *this; }
+            basic_iterator operator--(int) { basic_iterator tmp{*this}; index--; return tmp; }
+
+            basic_iterator& operator+=(int64_t k) { index += k; return *this; }
+            basic_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            basic_iterator operator+(int64_t k) const { basic_iterator tmp{*this}; tmp.index += k; return tmp; }
+            basic_iterator operator-(int64_t k) const { basic_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            int64_t operator-(const basic_iterator& it) const { return index - it.index; }
+
+            bool operator==(const basic_iterator& it) const { check_exception(); return index == it.index; }
+            bool operator!=(const basic_iterator& it) const { return !(*this == it); }
+            bool operator<(const basic_iterator& it) const { return index < it.index; }
+            bool operator>(const basic_iterator& it) const { return index > it.index; }
+            bool operator<=(const basic_iterator& it) const { return index <= it.index; }
+            bool operator>=(const basic_iterator& it) const { return index >= it.index; }
+
+#if EPL_CHECKED_ITERATORS
+            void set_version(void) { iterator_version = parent ? parent->version : 0; }
+
+            void check_exception() const{
+                if(parent != nullptr && iterator_version != parent->version)
+                    throw epl::invalid_iterator{    epl::invalid_iterator::MILD  };
+            }
+#else
+            void set_version(void) {}
+            void check_exception() const {}
+#endif
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        iterator begin(void) { return iterator(this, 0); }
+        iterator end(void) { return iterator(this, size()); }
+        const_iterator begin(void) const { return const_iterator(this, 0); }
+        const_iterator end(void) const { return const_iterator(this, size()); }
+
+        /**********************lookup*********************************/
+        iterator lower_bound(const Key& k) { return iterator(this, position(k)); }
+        const_iterator lower_bound(const Key& k) const { return const_iterator(this, position(k)); }
+
+        iterator upper_bound(const Key& k){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            return iterator(this, found(at, k) ? pos + 1 : pos);
+        }
+
+        const_iterator upper_bound(const Key& k) const{
+            const Key* at;
+            uint64_t pos = position(k, at);
+            return const_iterator(this, found(at, k) ? pos + 1 : pos);
+        }
+
+        iterator find(const Key& k){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            return found(at, k) ? iterator(this, pos) : end();
+        }
+
+        const_iterator find(const Key& k) const{
+            const Key* at;
+            uint64_t pos = position(k, at);
+            return found(at, k) ? const_iterator(this, pos) : end();
+        }
+
+        bool contains(const Key& k) const{
+            const Key* at;
+            position(k, at);
+            return found(at, k);
+        }
+        uint64_t count(const Key& k) const { return contains(k) ? 1 : 0; }
+
+        T& at(const Key& k){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            if(!found(at, k)) { throw std::out_of_range{"key not found"}; }
+            return value_list[pos];
+        }
+
+        const T& at(const Key& k) const{
+            const Key* at;
+            uint64_t pos = position(k, at);
+            if(!found(at, k)) { throw std::out_of_range{"key not found"}; }
+            return value_data()[pos];
+        }
+
+        //the value of k, inserted value-initialized if k is missing
+        T& operator[](const Key& k) { return value_list[try_insert(k).first]; }
+        T& operator[](Key&& k) { return value_list[try_insert(std::move(k)).first]; }
+
+        //makes the next lookup free of the index rebuild (eytzinger_lookup)
+        void build_index(void) const { search.prepare(key_data(), key_list.size()); }
+
+        /**********************insert and erase*********************************/
+        std::pair<iterator, bool> insert(const std::pair<Key, T>& entry) { return try_emplace(entry.first, entry.second); }
+        std::pair<iterator, bool> insert(std::pair<Key, T>&& entry) { return try_emplace(std::move(entry.first), std::move(entry.second)); }
+
+        //inserts T(args...) under k unless k is present; never touches args then
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const Key& k, Args&&... args){
+            std::pair<uint64_t, bool> r = try_insert(k, std::forward<Args>(args)...);
+            return std::make_pair(iterator(this, r.first), r.second);
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(Key&& k, Args&&... args){
+            std::pair<uint64_t, bool> r = try_insert(std::move(k), std::forward<Args>(args)...);
+            return std::make_pair(iterator(this, r.first), r.second);
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> emplace(const Key& k, Args&&... args) { return try_emplace(k, std::forward<Args>(args)...); }
+
+        template <typename V>
+        std::pair<iterator, bool> insert_or_assign(const Key& k, V&& v){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            if(found(at, k)){
+                value_list[pos] = std::forward<V>(v);
+                return std::make_pair(iterator(this, pos), false);
+            }
+            insert_entry(pos, k, std::forward<V>(v));
+            return std::make_pair(iterator(this, pos), true);
+        }
+
+        template <typename IT>
+        void insert(IT first, IT last){
+            vector<std::pair<Key, T>, entry_allocator> batch(first, last, entry_allocator(key_list.get_allocator()));
+            uint64_t n = batch.size();
+            if(n == 0) { return; }
+            std::pair<Key, T>* b = batch.data();
+            key_less less{&comp};
+            std::stable_sort(b, b + n, less);
+            n = std::unique(b, b + n, [&less](const std::pair<Key, T>& x, const std::pair<Key, T>& y) { return !less(x, y); }) - b;
+
+            uint64_t old = key_list.size();
+            const Key* k = key_data();
+            if(old == 0 || comp(k[old - 1], b[0].first)){
+                reserve(old + n);
+                for(uint64_t i = 0; i < n; i++){
+                    key_list.push_back(std::move(b[i].first));
+                    try { value_list.push_back(std::move(b[i].second)); }
+                    catch(...) { key_list.pop_back(); changed(); throw; }
+                }
+            }
+            else if(comp(b[n - 1].first, k[0])){
+                key_list.reserve_front(old + n);
+                value_list.reserve_front(old + n);
+                for(uint64_t i = n; i-- != 0; ){
+                    key_list.push_front(std::move(b[i].first));
+                    try { value_list.push_front(std::move(b[i].second)); }
+                    catch(...) { key_list.pop_front(); changed(); throw; }
+                }
+            }
+            else{
+                //one merge pass into new vectors; an existing key beats the batch
+                vector<Key, key_allocator> keys2(key_list.get_allocator());
+                vector<T, value_allocator> values2(value_list.get_allocator());
+                keys2.reserve(old + n);
+                values2.reserve(old + n);
+                Key* ok = key_list.data();
+                T* ov = value_list.data();
+                uint64_t i = 0, j = 0;
+                while(i < old || j < n){
+                    if(j == n || (i < old && !comp(b[j].first, ok[i]))){
+                        if(j < n && !comp(ok[i], b[j].first)) { j++; }
+                        keys2.push_back(std::move(ok[i]));
+                        values2.push_back(std::move(ov[i]));
+                        i++;
+                    }
+                    else{
+                        keys2.push_back(std::move(b[j].first));
+                        values2.push_back(std::move(b[j].second));
+                        j++;
+                    }
+                }
+                key_list = std::move(keys2);
+                value_list = std::move(values2);
+            }
+            changed();
+            build_index();
+        }
+
+        uint64_t erase(const Key& k){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            if(!found(at, k)) { return 0; }
+            flat_detail::erase_at(key_list, pos);
+            flat_detail::erase_at(value_list, pos);
+            changed();
+            return 1;
+        }
+
+        //erases the entry at it and returns an iterator to the one after it
+        iterator erase(const_iterator it){
+            uint64_t pos = it - begin();
+            flat_detail::erase_at(key_list, pos);
+            flat_detail::erase_at(value_list, pos);
+            changed();
+            return iterator(this, pos);
+        }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef _FLAT_SET_H_
+#define _FLAT_SET_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+#include "Vector.h"
+
+//Sorted-vector sets and maps (flat_set here, flat_map in FlatMap.h): the
+//keys sit in one contiguous epl::vector, so a lookup is a binary search
+//over an array instead of a walk through heap nodes. An insert in the
+//middle moves the shorter side of the vector by one, and an insert before
+//the first key lands in the vector's front slack like a push_front.
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //How lookups search the sorted keys (the Lookup parameter):
+    //branchless_lookup is a binary search whose steps compile to
+    //conditional moves, so it never mispredicts; eytzinger_lookup searches
+    //a second copy of the keys laid out in breadth-first (Eytzinger) order,
+    //where the next steps of a search share cache lines and can be
+    //prefetched. It wins on large tables of small keys, at the price of the
+    //copy, which is rebuilt after the keys change.
+    struct branchless_lookup {};
+    struct eytzinger_lookup {};
+
+namespace flat_detail{
+
+    template <typename Lookup, typename Key, typename Compare>
+    class index;
+
+    template <typename Key, typename Compare>
+    class index<branchless_lookup, Key, Compare>{
+    public:
+        void invalidate(void) {}
+        void prepare(const Key*, uint64_t) {}
+
+        //the first of keys[0, n) that is not less than x; at is set to that
+        //key, or to nullptr if there is none
+        uint64_t lower_bound(const Key* keys, uint64_t n, const Key& x, const Compare& comp, const Key*& at){
+            at = nullptr;
+            if(n == 0) { return 0; }
+            const Key* base = keys;
+            for(uint64_t left = n; left > 1; ){
+                uint64_t half = left / 2;
+                base = comp(base[half], x) ? base + half : base;
+                left -= half;
+            }
+            uint64_t pos = (base - keys) + comp(*base, x);
+            if(pos < n) { at = keys + pos; }
+            return pos;
+        }
+    };
+
+    template <typename Key, typename Compare>
+    class index<eytzinger_lookup, Key, Compare>{
+    private:
+        vector<Key> tree;           //tree[k] is node k, with children 2k and 2k + 1; tree[0] pads
+        bool stale = true;
+
+        //keys per cache line, rounded down to a power of two
+        static constexpr uint64_t line(uint64_t n = 64 / (sizeof(Key) ? sizeof(Key) : 1), uint64_t p = 1){
+            return (p * 2 > n) ? p : line(n, p * 2);
+        }
+
+        static uint64_t log2(uint64_t x) { return 63 - __builtin_clzll(x); }
+
+        //Where node k of an n-node tree sits in the sorted keys. The tree is
+        //perfect down to depth h, whose level holds only the first
+        //n - 2^h + 1 of its 2^h leaves; in order, leaf i of a perfect tree
+        //comes at 2i, so each missing leaf before node k moves it back one.
+        static uint64_t rank(uint64_t k, uint64_t n){
+            uint64_t h = log2(n), d = log2(k);
+            uint64_t perfect = ((2 * (k - (uint64_t(1) << d)) + 1) << (h - d)) - 1;
+            uint64_t leaves = n - (uint64_t(1) << h) + 1;
+            uint64_t before = (perfect + 1) / 2;
+            return perfect - ((before > leaves) ? before - leaves : 0);
+        }
+
+    public:
+        void invalidate(void) { stale = true; }
+
+        //rebuilds the search copy if the keys changed since the last one
+        void prepare(const Key* keys, uint64_t n){
+            if(!stale) { return; }
+            tree.clear();
+            tree.reserve(n + 1);
+            //node k at tree[k] puts each group of line() siblings on one cache line
+            if(n != 0) { tree.push_back(keys[0]); }
+            for(uint64_t k = 1; k <= n; k++) { tree.push_back(keys[rank(k, n)]); }
+            stale = false;
+        }
+
+        //as for branchless_lookup, except that at points into the search copy
+        uint64_t lower_bound(const Key* keys, uint64_t n, const Key& x, const Compare& comp, const Key*& at){
+            prepare(keys, n);
+            const Key* t = static_cast<const vector<Key>&>(tree).data();
+            const uint64_t ahead = line();
+            uint64_t k = 1;
+            while(k <= n){
+                //a prefetch past the end is harmless, so it needs no test
+                __builtin_prefetch(t + k * ahead);
+                k = 2 * k + comp(t[k], x);
+            }
+            //undo the right turns taken after the last left turn
+            k >>= __builtin_ffsll(~k);
+            at = (k == 0) ? nullptr : t + k;
+            return (k == 0) ? n : rank(k, n);
+        }
+    };
+
+    //puts x at position pos of v by moving the shorter side out by one
+    template <typename V, typename X>
+    void insert_at(V& v, uint64_t pos, X&& x){
+        uint64_t n = v.size();
+        if(pos < n - pos){
+            v.push_front(std::forward<X>(x));
+            auto p = v.data();
+            std::rotate(p, p + 1, p + pos + 1);
+        }
+        else{
+            v.push_back(std::forward<X>(x));
+            auto p = v.data();
+            std::rotate(p + pos, p + n, p + n + 1);
+        }
+    }
+
+    //removes the element at pos by moving the shorter side in by one
+    template <typename V>
+    void erase_at(V& v, uint64_t pos){
+        uint64_t n = v.size();
+        auto p = v.data();
+        if(pos < n - pos - 1){
+            std::rotate(p, p + pos, p + pos + 1);
+            v.pop_front();
+        }
+        else{
+            std::rotate(p + pos, p + pos + 1, p + n);
+            v.pop_back();
+        }
+    }
+
+} //namespace flat_detail
+
+    //A set of unique keys kept sorted in an epl::vector. Iterators are the
+    //vector's const iterators, so any insert or erase invalidates them.
+    //
+    //insert(first, last) sorts the batch on its own, then appends it,
+    //prepends it (into the front slack) or merges it with the keys in one
+    //linear pass, instead of inserting key by key. Keys already present
+    //are kept over equal keys in the batch, as are earlier keys in the
+    //batch over later ones.
+    //
+    //With eytzinger_lookup the first lookup after a change rebuilds the
+    //search copy, so call build_index() before sharing the set with
+    //concurrent readers.
+    template <typename Key, typename Compare = std::less<Key>, typename Lookup = branchless_lookup, typename Alloc = allocator<Key> >
+    class flat_set{
+    private:
+        vector<Key, Alloc> keys;
+        Compare comp;
+        mutable flat_detail::index<Lookup, Key, Compare> search;
+
+        const Key* key_data(void) const { return static_cast<const vector<Key, Alloc>&>(keys).data(); }
+
+        //the index of the first key not less than k; at is set to that key
+        //(nullptr at the end), which may be the search copy's equal of it
+        uint64_t position(const Key& k, const Key*& at) const { return search.lower_bound(key_data(), keys.size(), k, comp, at); }
+
+        uint64_t position(const Key& k) const{
+            const Key* at;
+            return position(k, at);
+        }
+
+        bool found(const Key* at, const Key& k) const { return at != nullptr && !comp(k, *at); }
+
+        template <typename X>
+        std::pair<uint64_t, bool> insert_key(X&& k){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            if(found(at, k)) { return std::make_pair(pos, false); }
+            flat_detail::insert_at(keys, pos, std::forward<X>(k));
+            search.invalidate();
+            return std::make_pair(pos, true);
+        }
+
+    public:
+        typedef Key key_type;
+        typedef Key value_type;
+        typedef Compare key_compare;
+        typedef typename vector<Key, Alloc>::const_iterator iterator;
+        typedef typename vector<Key, Alloc>::const_iterator const_iterator;
+
+        flat_set(void) {}
+
+        explicit flat_set(const Compare& c, const Alloc& a = Alloc()) : keys(a), comp(c) {}
+
+        flat_set(std::initializer_list<Key> i1, const Compare& c = Compare(), const Alloc& a = Alloc())
+            : keys(a), comp(c) {
+            insert(i1.begin(), i1.end());
+        }
+
+        template <typename IT>
+        flat_set(IT b, IT e, const Compare& c = Compare(), const Alloc& a = Alloc()) : keys(a), comp(c) {
+            insert(b, e);
+        }
+
+        uint64_t size(void) const { return keys.size(); }
+        bool empty(void) const { return keys.empty(); }
+        void reserve(uint64_t n) { keys.reserve(n); }
+        void clear(void) { keys.clear(); search.invalidate(); }
+
+        //the keys in order, as one contiguous array
+        const Key* data(void) const { return key_data(); }
+
+        const_iterator begin(void) const { return static_cast<const vector<Key, Alloc>&>(keys).begin(); }
+        const_iterator end(void) const { return static_cast<const vector<Key, Alloc>&>(keys).end(); }
+
+        /**********************lookup*********************************/
+        const_iterator lower_bound(const Key& k) const { return begin() + position(k); }
+
+        const_iterator upper_bound(const Key& k) const{
+            const Key* at;
+            uint64_t pos = position(k, at);
+            return begin() + (found(at, k) ? pos + 1 : pos);
+        }
+
+        const_iterator find(const Key& k) const{
+            const Key* at;
+            uint64_t pos = position(k, at);
+            return found(at, k) ? begin() + pos : end();
+        }
+
+        bool contains(const Key& k) const{
+            const Key* at;
+            position(k, at);
+            return found(at, k);
+        }
+        uint64_t count(const Key& k) const { return contains(k) ? 1 : 0; }
+
+        //makes the next lookup free of the index rebuild (eytzinger_lookup)
+        void build_index(void) const { search.prepare(key_data(), keys.size()); }
+
+        /**********************insert and erase*********************************/
+        std::pair<const_iterator, bool> insert(const Key& k){
+            std::pair<uint64_t, bool> r = insert_key(k);
+            return std::make_pair(begin() + r.first, r.second);
+        }
+
+        std::pair<const_iterator, bool> insert(Key&& k){
+            std::pair<uint64_t, bool> r = insert_key(std::move(k));
+            return std::make_pair(begin() + r.first, r.second);
+        }
+
+        template <typename IT>
+        void insert(IT first, IT last){
+            vector<Key, Alloc> batch(first, last, keys.get_allocator());
+            uint64_t n = batch.size();
+            if(n == 0) { return; }
+            Key* b = batch.data();
+            std::stable_sort(b, b + n, comp);
+            n = std::unique(b, b + n, [this](const Key& x, const Key& y) { return !comp(x, y); }) - b;
+            uint64_t old = keys.size();
+            const Key* k = key_data();
+            if(old == 0 || comp(k[old - 1], b[0])){
+                keys.append(std::make_move_iterator(b), std::make_move_iterator(b + n));
+            }
+            else if(comp(b[n - 1], k[0])){
+                keys.prepend(std::make_move_iterator(b), std::make_move_iterator(b + n));
+            }
+            else{
+                keys.append(std::make_move_iterator(b), std::make_move_iterator(b + n));
+                Key* p = keys.data();
+                std::inplace_merge(p, p + old, p + old + n, comp);
+                uint64_t m = std::unique(p, p + old + n, [this](const Key& x, const Key& y) { return !comp(x, y); }) - p;
+                while(keys.size() > m) { keys.pop_back(); }
+            }
+            search.invalidate();
+            build_index();
+        }
+
+        uint64_t erase(const Key& k){
+            const Key* at;
+            uint64_t pos = position(k, at);
+            if(!found(at, k)) { return 0; }
+            flat_detail::erase_at(keys, pos);
+            search.invalidate();
+            return 1;
+        }
+
+        //erases the key at it and returns an iterator to the key after it
+        const_iterator erase(const_iterator it){
+            uint64_t pos = it - begin();
+            flat_detail::erase_at(keys, pos);
+            search.invalidate();
+            return begin() + pos;
+        }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef _GROWTH_H_
+#define _GROWTH_H_
+
+#include <cstdint>
+
+//Growth policies for epl::vector (its third template parameter). A policy
+//is a type with two static member templates:
+//
+//  template <typename T> static uint64_t initial(void);
+//      capacity of a fresh vector of T
+//  template <typename T> static uint64_t next(uint64_t capacity);
+//      capacity of the block that replaces a full one of `capacity`
+//
+//The vector never takes less than it needs, so next() may return any
+//value; one that does not grow is treated as capacity + 1.
+
+namespace epl{
+
+    //Capacity of a fresh vector of T under the stock policies. Specialize it
+    //for element types that are known to come in larger (or smaller) sets.
+    template <typename T>
+    struct initial_capacity { static const uint64_t value = 8; };
+
+    //capacity * Num / Den. 2/1 is the classic doubling; a factor under the
+    //golden ratio (1.5, 8/5) lets a block be carved from the ones freed
+    //before it, so the allocator can reuse memory, and it leaves less
+    //unused capacity at the end.
+    template <uint64_t Num, uint64_t Den>
+    struct factor_growth{
+        static_assert(Num > Den && Den != 0, "the growth factor must be above 1");
+
+        template <typename T>
+        static uint64_t initial(void) { return initial_capacity<T>::value; }
+
+        template <typename T>
+        static uint64_t next(uint64_t capacity){
+            uint64_t n = capacity / Den * Num + capacity % Den * Num / Den;
+            return (n > capacity) ? n : capacity + 1;
+        }
+    };
+
+    typedef factor_growth<2, 1> double_growth;
+    typedef factor_growth<3, 2> growth_1_5x;
+    typedef factor_growth<8, 5> golden_growth;      //8/5: a ratio of Fibonacci numbers, just below 1.618
+
+    //Grows like Base until a block holds Cap bytes, then by Cap bytes at a
+    //time, bounding the unused capacity of very large vectors.
+    template <uint64_t Cap, typename Base = double_growth>
+    struct capped_growth{
+        template <typename T>
+        static uint64_t initial(void) { return Base::template initial<T>(); }
+
+        template <typename T>
+        static uint64_t next(uint64_t capacity){
+            const uint64_t step = (Cap / sizeof(T) == 0) ? 1 : Cap / sizeof(T);
+            if(capacity >= step) { return capacity + step; }
+            uint64_t n = Base::template next<T>(capacity);
+            return (n > step) ? step : n;
+        }
+    };
+
+    //Rounds Base's block up to the allocator's size classes: four classes
+    //per power of two, the spacing used by jemalloc and tcmalloc, with 16
+    //byte steps below 128 bytes. The room malloc would have added anyway
+    //becomes usable capacity.
+    template <typename Base = double_growth>
+    struct size_class_growth{
+        static uint64_t round_bytes(uint64_t bytes){
+            if(bytes <= 128) { return (bytes + 15) & ~uint64_t(15); }
+            uint64_t step = (uint64_t(1) << (63 - __builtin_clzll(bytes - 1))) / 4;
+            return (bytes + step - 1) / step * step;
+        }
+
+        template <typename T>
+        static uint64_t initial(void) { return round_bytes(Base::template initial<T>() * sizeof(T)) / sizeof(T); }
+
+        template <typename T>
+        static uint64_t next(uint64_t capacity) { return round_bytes(Base::template next<T>(capacity) * sizeof(T)) / sizeof(T); }
+    };
+
+    //Rounds Base's block up to whole pages once it is at least a page, so
+    //large blocks (which come straight from mmap) leave no partial page.
+    template <typename Base = double_growth, uint64_t Page = 4096>
+    struct page_growth{
+        static_assert(Page != 0 && (Page & (Page - 1)) == 0, "the page size must be a power of two");
+
+        static uint64_t round_bytes(uint64_t bytes) { return (bytes < Page) ? bytes : (bytes + Page - 1) & ~(Page - 1); }
+
+        template <typename T>
+        static uint64_t initial(void) { return round_bytes(Base::template initial<T>() * sizeof(T)) / sizeof(T); }
+
+        template <typename T>
+        static uint64_t next(uint64_t capacity) { return round_bytes(Base::template next<T>(capacity) * sizeof(T)) / sizeof(T); }
+    };
+
+    //Base with a fixed initial capacity, for one container rather than
+    //every container of the type (see initial_capacity)
+    template <uint64_t N, typename Base = double_growth>
+    struct initial_growth{
+        static_assert(N != 0, "the initial capacity must be at least 1");
+
+        template <typename T>
+        static uint64_t initial(void) { return N; }
+
+        template <typename T>
+        static uint64_t next(uint64_t capacity) { return Base::template next<T>(capacity); }
+    };
+
+} //namespace epl
+
+#endif
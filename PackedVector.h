@@ -0,0 +1,339 @@
+#ifndef _PACKED_VECTOR_H_
+#define _PACKED_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "BitVector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //A double-ended sequence of unsigned integers of Bits bits each, packed
+    //end to end into an epl::vector<uint64_t>: packed_vector<3> holds 21
+    //values a word instead of one. When Bits divides 64 no value straddles
+    //two words; otherwise a value may, and is read with two loads.
+    //
+    //Pushing a value that needs more than Bits bits throws
+    //std::out_of_range. unpack() decodes a run of values into a plain array
+    //with one pass over the words; it is the fast way to read many values.
+    template <unsigned Bits, typename Alloc = allocator<uint64_t> >
+    class packed_vector{
+    private:
+        static_assert(Bits >= 1 && Bits <= 64, "the bit width must be between 1 and 64");
+
+        static constexpr uint64_t mask = (Bits == 64) ? ~uint64_t(0) : (uint64_t(1) << Bits) - 1;
+
+        vector<uint64_t, Alloc> words;
+        uint64_t head;              //unused bits below the first value in words[0]
+        uint64_t length;
+        uint64_t front_version;     //bumped when indexes shift (front push/pop)
+
+        const uint64_t* word_data(void) const { return static_cast<const vector<uint64_t, Alloc>&>(words).data(); }
+
+        void init(void){
+            head = 0;
+            length = 0;
+            front_version = 0;
+        }
+
+        uint64_t get(uint64_t k) const{
+            const uint64_t* w = word_data();
+            uint64_t p = head + k * Bits;
+            uint64_t i = p / 64, b = p % 64;
+            uint64_t v = w[i] >> b;
+            if(b + Bits > 64) { v |= w[i + 1] << (64 - b); }
+            return v & mask;
+        }
+
+        void put(uint64_t k, uint64_t v){
+            uint64_t* w = words.data();
+            uint64_t p = head + k * Bits;
+            uint64_t i = p / 64, b = p % 64;
+            w[i] = (w[i] & ~(mask << b)) | (v << b);
+            if(b + Bits > 64){
+                uint64_t spill = b + Bits - 64;
+                w[i + 1] = (w[i + 1] & ~bits_detail::low_mask(spill)) | (v >> (64 - b));
+            }
+        }
+
+        static uint64_t checked(uint64_t v){
+            if((v & ~mask) != 0) { throw std::out_of_range{"value does not fit in the bit width"}; }
+            return v;
+        }
+
+    public:
+        typedef uint64_t value_type;
+        typedef Alloc allocator_type;
+
+        //a writable value: converts to uint64_t and assigns through to the words
+        class reference{
+        private:
+            packed_vector* parent;
+            uint64_t index;
+
+            friend class packed_vector;
+            reference(packed_vector* parent, uint64_t index) { this->parent = parent; this->index = index; }
+
+        public:
+            operator uint64_t(void) const { return parent->get(index); }
+
+            reference& operator=(uint64_t v){
+                parent->put(index, checked(v));
+                return *this;
+            }
+
+            reference& operator=(const reference& that) { return *this = uint64_t(that); }
+        };
+
+        packed_vector(void) { init(); }
+
+        explicit packed_vector(const Alloc& a) : words(a) { init(); }
+
+        explicit packed_vector(uint64_t n, uint64_t v = 0, const Alloc& a = Alloc()) : words(a) {
+            init();
+            reserve(n);
+            for(uint64_t k = 0; k < n; k++) { push_back(v); }
+        }
+
+        packed_vector(std::initializer_list<uint64_t> i1, const Alloc& a = Alloc()) : words(a) {
+            init();
+            reserve(i1.size());
+            for(auto iter = i1.begin(); iter != i1.end(); ++iter) { push_back(*iter); }
+        }
+
+        template<typename IT>
+        packed_vector(IT b, IT e, const Alloc& a = Alloc()) : words(a) {
+            init();
+            for(; b != e; ++b) { push_back(*b); }
+        }
+
+        packed_vector(const packed_vector& that) : words(that.words) {
+            head = that.head; length = that.length;
+            front_version = 0;
+        }
+
+        packed_vector(packed_vector&& that) noexcept : words(std::move(that.words)) {
+            head = that.head; length = that.length;
+            front_version = 0;
+            that.init();
+        }
+
+        packed_vector& operator=(const packed_vector& that){
+            if(this != &that){
+                words = that.words;
+                head = that.head; length = that.length;
+            }
+            front_version++;
+            return *this;
+        }
+
+        packed_vector& operator=(packed_vector&& that) noexcept{
+            if(this != &that){
+                words = std::move(that.words);
+                head = that.head; length = that.length;
+                that.init();
+            }
+            front_version++;
+            return *this;
+        }
+
+        uint64_t size(void) const { return length; }
+        bool empty(void) const { return length == 0; }
+        static constexpr unsigned bit_width(void) { return Bits; }
+        static constexpr uint64_t max_value(void) { return mask; }
+
+        //bytes of element storage in use, without the slack
+        uint64_t bytes(void) const { return words.size() * sizeof(uint64_t); }
+
+        void reserve(uint64_t n) { words.reserve((head + n * Bits + 63) / 64); }
+
+        uint64_t operator[](uint64_t k) const{
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            return get(k);
+        }
+
+        reference operator[](uint64_t k){
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            return reference(this, k);
+        }
+
+        //Decodes the values [first, first + n) into out[0, n). Walks the
+        //words once, carrying the current word along instead of locating
+        //each value from its index.
+        template <typename U>
+        void unpack(uint64_t first, uint64_t n, U* out) const{
+            static_assert(std::is_integral<U>::value, "values unpack into an integer array");
+            if(first > length || n > length - first) { throw std::out_of_range{"range out of range"}; }
+            if(n == 0) { return; }
+            uint64_t p = head + first * Bits;
+            const uint64_t* w = word_data() + p / 64;
+            if(64 % Bits == 0){
+                //no value straddles two words
+                const uint64_t per_word = 64 / Bits;
+                uint64_t k = 0, b = p % 64 / Bits;
+                for(; k < n && b != 0 && b < per_word; k++, b++) { out[k] = U((*w >> (b * Bits)) & mask); }
+                if(b == per_word) { w++; }
+                for(; k + per_word <= n; k += per_word, w++){
+                    uint64_t cur = *w;
+                    for(uint64_t j = 0; j < per_word; j++) { out[k + j] = U((cur >> (j * Bits)) & mask); }
+                }
+                for(uint64_t j = 0; k < n; k++, j++) { out[k] = U((*w >> (j * Bits)) & mask); }
+                return;
+            }
+            uint64_t b = p % 64;
+            uint64_t cur = *w;
+            for(uint64_t k = 0; k < n; k++){
+                uint64_t v = cur >> b;
+                b += Bits;
+                if(b >= 64){
+                    b -= 64;
+                    //the rest of this value, if any, and the next values are
+                    //in the next word, which exists unless this was the last
+                    if(b != 0 || k + 1 < n) { cur = *++w; }
+                    if(b != 0) { v |= cur << (Bits - b); }
+                }
+                out[k] = U(v & mask);
+            }
+        }
+
+        /**********************push and pop*********************************/
+        void push_back(uint64_t v){
+            checked(v);
+            uint64_t end = head + (length + 1) * Bits;
+            while(words.size() * 64 < end) { words.push_back(0); }
+            length++;
+            put(length - 1, v);
+        }
+
+        void push_front(uint64_t v){
+            checked(v);
+            if(words.empty()) { words.push_back(0); head = 64; }
+            else if(head < Bits) { words.push_front(0); head += 64; }
+            head -= Bits;
+            length++;
+            put(0, v);
+            front_version++;
+        }
+
+        void pop_back(void){
+            if(length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            put(length - 1, 0);
+            length--;
+            if(length == 0) { words.clear(); head = 0; return; }
+            uint64_t need = (head + length * Bits + 63) / 64;
+            while(words.size() > need) { words.pop_back(); }
+        }
+
+        void pop_front(void){
+            if(length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            put(0, 0);
+            head += Bits;
+            length--;
+            if(length == 0) { words.clear(); head = 0; }
+            else{
+                while(head >= 64) { words.pop_front(); head -= 64; }
+            }
+            front_version++;
+        }
+
+        void clear(void){
+            words.clear();
+            head = 0;
+            length = 0;
+            front_version++;
+        }
+
+        /**********************iterator class*********************************/
+        //An index into the values. Pushing at the back never invalidates it;
+        //pushing or popping at the front shifts every index, which a checked
+        //iterator reports as a MILD invalid_iterator.
+        template <bool Const>
+        class basic_iterator{
+        private:
+            typedef typename std::conditional<Const, const packed_vector, packed_vector>::type container;
+            container* parent;
+            int64_t index;
+#if EPL_CHECKED_ITERATORS
+            uint64_t iterator_version;
+#endif
+
+            friend class packed_vector;
+            template <bool> friend class basic_iterator;
+
+        public:
+            typedef uint64_t value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef void pointer;
+            typedef typename std::conditional<Const, uint64_t, typename packed_vector::reference>::type reference;
+
+            basic_iterator(void) { parent = nullptr; index = 0; set_version(); }
+
+            basic_iterator(container* parent, int64_t index){
+                this->parent = parent;
+                this->index = index;
+                set_version();
+            }
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            basic_iterator(const basic_iterator<C>& it){
+                parent = it.parent;
+                index = it.index;
+#if EPL_CHECKED_ITERATORS
+                iterator_version = it.iterator_version;
+#endif
+            }
+
+            reference operator*(void) const { check_exception(); return (*parent)[index]; }
+            reference operator[](int64_t k) const { check_exception(); return (*parent)[index + k]; }
+
+            basic_iterator& operator++() { index++; return *this; }
+            basic_iterator operator++(int) { basic_iterator tmp{*this}; index++; return tmp; }
+            basic_iterator& operator--() { index--; return *this; }
+            basic_iterator operator--(int) { basic_iterator tmp{*this}; index--; return tmp; }
+
+            basic_iterator& operator+=(int64_t k) { index += k; return *this; }
+            basic_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            basic_iterator operator+(int64_t k) const { basic_iterator tmp{*this}; tmp.index += k; return tmp; }
+            basic_iterator operator-(int64_t k) const { basic_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            int64_t operator-(const basic_iterator& it) const { return index - it.index; }
+
+            bool operator==(const basic_iterator& it) const { check_exception(); return index == it.index; }
+            bool operator!=(const basic_iterator& it) const { return !(*this == it); }
+            bool operator<(const basic_iterator& it) const { return index < it.index; }
+            bool operator>(const basic_iterator& it) const { return index > it.index; }
+            bool operator<=(const basic_iterator& it) const { return index <= it.index; }
+            bool operator>=(const basic_iterator& it) const { return index >= it.index; }
+
+#if EPL_CHECKED_ITERATORS
+            void set_version(void) { iterator_version = parent ? parent->front_version : 0; }
+
+            void check_exception() const{
+                if(parent != nullptr && iterator_version != parent->front_version)
+                    throw epl::invalid_iterator{    epl::invalid_iterator::MILD  };
+            }
+#else
+            void set_version(void) {}
+            void check_exception() const {}
+#endif
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        iterator begin(void) { return iterator(this, 0); }
+        iterator end(void) { return iterator(this, length); }
+        const_iterator begin(void) const { return const_iterator(this, 0); }
+        const_iterator end(void) const { return const_iterator(this, length); }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,394 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "Vector.h"
+
+//Parallel algorithms over epl::vector and random access ranges. A range is
+//cut into chunks which run on a shared work-stealing pool: every thread
+//starts with an equal run of chunk indexes, takes chunks from the front of
+//its own run and, once that is empty, steals the back half of another
+//thread's run. The calling thread works as one of the pool's threads.
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    class thread_pool{
+    private:
+        //the chunk indexes [lo, hi) one thread still has to run
+        struct work_range{
+            std::mutex m;
+            uint64_t lo;
+            uint64_t hi;
+        };
+
+        //One parallel_for call. It lives on the caller's stack, and workers
+        //reach it only through current, which they read under m.
+        struct job_state{
+            const std::function<void(uint64_t)>* body;
+            work_range* ranges;
+            std::atomic<uint64_t> remaining;    //chunks not yet finished
+            std::atomic<bool> failed;           //once set, the chunks left are skipped
+            std::mutex error_m;
+            std::exception_ptr error;           //the first exception a chunk threw
+        };
+
+        //marks this thread as running chunks until the scope ends, however it ends
+        class pool_scope{
+        private:
+            bool saved;
+
+        public:
+            pool_scope(void) { saved = inside_pool(); inside_pool() = true; }
+            ~pool_scope(void) { inside_pool() = saved; }
+        };
+
+        vector<std::thread> threads;
+        work_range* ranges;             //one per thread, ranges[0] is the caller's
+        unsigned count;
+
+        std::mutex m;
+        std::condition_variable wake;
+        std::condition_variable done;
+        uint64_t generation;
+        unsigned active;                //workers inside the current job
+        bool stop;
+        job_state* current;             //nullptr between jobs
+
+        std::mutex job;                 //one parallel_for at a time
+
+        static bool& inside_pool(void){
+            static thread_local bool flag = false;
+            return flag;
+        }
+
+        bool take(work_range* ranges, unsigned self, uint64_t& chunk){
+            {
+                std::lock_guard<std::mutex> lock(ranges[self].m);
+                if(ranges[self].lo < ranges[self].hi){
+                    chunk = ranges[self].lo++;
+                    return true;
+                }
+            }
+            for(unsigned k = 1; k < count; k++){
+                work_range& victim = ranges[(self + k) % count];
+                uint64_t lo, hi;
+                {
+                    std::lock_guard<std::mutex> lock(victim.m);
+                    if(victim.lo >= victim.hi) { continue; }
+                    uint64_t mid = victim.hi - (victim.hi - victim.lo + 1) / 2;
+                    lo = mid; hi = victim.hi;
+                    victim.hi = mid;
+                }
+                chunk = lo;
+                if(lo + 1 < hi){
+                    std::lock_guard<std::mutex> lock(ranges[self].m);
+                    ranges[self].lo = lo + 1;
+                    ranges[self].hi = hi;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void work(job_state& j, unsigned self){
+            uint64_t chunk;
+            while(take(j.ranges, self, chunk)){
+                if(!j.failed.load(std::memory_order_relaxed)){
+                    try { (*j.body)(chunk); }
+                    catch(...){
+                        std::lock_guard<std::mutex> lock(j.error_m);
+                        if(!j.error) { j.error = std::current_exception(); }
+                        j.failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+                if(j.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                    std::lock_guard<std::mutex> lock(m);
+                    done.notify_all();
+                }
+            }
+        }
+
+        void worker(unsigned self){
+            inside_pool() = true;
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(m);
+            while(true){
+                //a worker that wakes after its job is over finds current
+                //empty (or already the next job) and never sees a stale body
+                wake.wait(lock, [&]{ return stop || (current != nullptr && generation != seen); });
+                if(stop) { return; }
+                seen = generation;
+                job_state* j = current;
+                active++;
+                lock.unlock();
+                work(*j, self);
+                lock.lock();
+                active--;
+                if(active == 0) { done.notify_all(); }
+            }
+        }
+
+    public:
+        explicit thread_pool(unsigned n = std::thread::hardware_concurrency()){
+            count = (n == 0) ? 1 : n;
+            ranges = new work_range[count];
+            generation = 0;
+            active = 0;
+            stop = false;
+            current = nullptr;
+            for(unsigned k = 1; k < count; k++){
+                threads.emplace_back(&thread_pool::worker, this, k);
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        ~thread_pool(void){
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stop = true;
+            }
+            wake.notify_all();
+            for(uint64_t k = 0; k < threads.size(); k++) { threads[k].join(); }
+            delete[] ranges;
+        }
+
+        //threads that run chunks, counting the caller
+        unsigned size(void) const { return count; }
+
+        //the pool used when an algorithm is not given one
+        static thread_pool& instance(void){
+            static thread_pool pool;
+            return pool;
+        }
+
+        //Runs f(0) .. f(chunks - 1) and returns when all are done; a call
+        //from inside a running chunk executes serially. If f throws, the
+        //chunks not yet started are skipped and the first exception is
+        //rethrown here once every thread has left the job.
+        void parallel_for(uint64_t chunks, const std::function<void(uint64_t)>& f){
+            if(chunks == 0) { return; }
+            if(count == 1 || chunks == 1 || inside_pool()){
+                for(uint64_t c = 0; c < chunks; c++) { f(c); }
+                return;
+            }
+            std::lock_guard<std::mutex> serial(job);
+            job_state j;
+            j.body = &f;
+            j.ranges = ranges;
+            j.remaining.store(chunks, std::memory_order_relaxed);
+            j.failed.store(false, std::memory_order_relaxed);
+            for(unsigned k = 0; k < count; k++){
+                std::lock_guard<std::mutex> lock(ranges[k].m);
+                ranges[k].lo = chunks * k / count;
+                ranges[k].hi = chunks * (k + 1) / count;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m);
+                current = &j;
+                generation++;
+            }
+            wake.notify_all();
+            {
+                pool_scope scope;
+                work(j, 0);
+            }
+            {
+                //no worker may still hold j once it goes out of scope
+                std::unique_lock<std::mutex> lock(m);
+                done.wait(lock, [&]{ return j.remaining.load(std::memory_order_acquire) == 0 && active == 0; });
+                current = nullptr;
+            }
+            if(j.error) { std::rethrow_exception(j.error); }
+        }
+    };
+
+
+    /*********************chunking******************************************/
+    //elements per chunk below which a range is not split further
+    static const uint64_t parallel_grain = 4096;
+
+    //number of chunks for n elements: enough for stealing to balance the
+    //load, none smaller than the grain
+    inline uint64_t parallel_chunks(uint64_t n, thread_pool& pool){
+        uint64_t chunks = n / parallel_grain;
+        uint64_t most = uint64_t(pool.size()) * 8;
+        if(chunks > most) { chunks = most; }
+        return (chunks == 0) ? 1 : chunks;
+    }
+
+    inline uint64_t chunk_begin(uint64_t c, uint64_t chunks, uint64_t n) { return n * c / chunks; }
+
+
+    /*********************for_each and transform***************************/
+    template <typename IT, typename F>
+    void parallel_for_each(IT first, IT last, F f, thread_pool& pool = thread_pool::instance()){
+        uint64_t n = last - first;
+        uint64_t chunks = parallel_chunks(n, pool);
+        pool.parallel_for(chunks, [&](uint64_t c){
+            IT b = first + chunk_begin(c, chunks, n);
+            IT e = first + chunk_begin(c + 1, chunks, n);
+            for(; b != e; ++b) { f(*b); }
+        });
+    }
+
+    template <typename T, typename A, typename G, typename F>
+    void parallel_for_each(vector<T, A, G>& v, F f, thread_pool& pool = thread_pool::instance()){
+        parallel_for_each(v.data(), v.data() + v.size(), f, pool);
+    }
+
+    template <typename IT, typename OUT, typename F>
+    OUT parallel_transform(IT first, IT last, OUT out, F f, thread_pool& pool = thread_pool::instance()){
+        uint64_t n = last - first;
+        uint64_t chunks = parallel_chunks(n, pool);
+        pool.parallel_for(chunks, [&](uint64_t c){
+            uint64_t b = chunk_begin(c, chunks, n), e = chunk_begin(c + 1, chunks, n);
+            IT in = first + b;
+            OUT o = out + b;
+            for(uint64_t k = b; k < e; ++k, ++in, ++o) { *o = f(*in); }
+        });
+        return out + n;
+    }
+
+    //out must already hold v.size() elements
+    template <typename T, typename A, typename G, typename U, typename B, typename H, typename F>
+    void parallel_transform(const vector<T, A, G>& v, vector<U, B, H>& out, F f, thread_pool& pool = thread_pool::instance()){
+        if(out.size() < v.size()) { throw std::out_of_range{"output vector too small"}; }
+        parallel_transform(v.data(), v.data() + v.size(), out.data(), f, pool);
+    }
+
+
+    /*********************reduce and scan**********************************/
+    //op must be associative; partial results are combined in chunk order
+    template <typename IT, typename R, typename OP>
+    R parallel_reduce(IT first, IT last, R init, OP op, thread_pool& pool = thread_pool::instance()){
+        uint64_t n = last - first;
+        if(n == 0) { return init; }
+        uint64_t chunks = parallel_chunks(n, pool);
+        vector<R> partial(chunks);
+        pool.parallel_for(chunks, [&](uint64_t c){
+            IT b = first + chunk_begin(c, chunks, n);
+            IT e = first + chunk_begin(c + 1, chunks, n);
+            R acc = *b;
+            for(++b; b != e; ++b) { acc = op(acc, *b); }
+            partial[c] = acc;
+        });
+        for(uint64_t c = 0; c < chunks; c++) { init = op(init, partial[c]); }
+        return init;
+    }
+
+    template <typename T, typename A, typename G, typename R, typename OP>
+    R parallel_reduce(const vector<T, A, G>& v, R init, OP op, thread_pool& pool = thread_pool::instance()){
+        return parallel_reduce(v.data(), v.data() + v.size(), init, op, pool);
+    }
+
+    template <typename T, typename A, typename G>
+    T parallel_reduce(const vector<T, A, G>& v, thread_pool& pool = thread_pool::instance()){
+        return parallel_reduce(v.data(), v.data() + v.size(), T(), std::plus<T>(), pool);
+    }
+
+    //out[k] = first[0] op ... op first[k]; out may equal first
+    template <typename IT, typename OUT, typename OP>
+    OUT parallel_inclusive_scan(IT first, IT last, OUT out, OP op, thread_pool& pool = thread_pool::instance()){
+        typedef typename std::iterator_traits<IT>::value_type value_type;
+        uint64_t n = last - first;
+        if(n == 0) { return out; }
+        uint64_t chunks = parallel_chunks(n, pool);
+        vector<value_type> carry(chunks);
+        /***********pass 1: scan each chunk on its own************/
+        pool.parallel_for(chunks, [&](uint64_t c){
+            uint64_t b = chunk_begin(c, chunks, n), e = chunk_begin(c + 1, chunks, n);
+            value_type acc = first[b];
+            out[b] = acc;
+            for(uint64_t k = b + 1; k < e; k++) { acc = op(acc, first[k]); out[k] = acc; }
+            carry[c] = acc;
+        });
+        /***********carry into each chunk the total of those before it****/
+        for(uint64_t c = 1; c < chunks; c++) { carry[c] = op(carry[c - 1], carry[c]); }
+        pool.parallel_for(chunks, [&](uint64_t c){
+            if(c == 0) { return; }
+            uint64_t b = chunk_begin(c, chunks, n), e = chunk_begin(c + 1, chunks, n);
+            for(uint64_t k = b; k < e; k++) { out[k] = op(carry[c - 1], out[k]); }
+        });
+        return out + n;
+    }
+
+    template <typename T, typename A, typename G>
+    void parallel_inclusive_scan(vector<T, A, G>& v, thread_pool& pool = thread_pool::instance()){
+        parallel_inclusive_scan(v.data(), v.data() + v.size(), v.data(), std::plus<T>(), pool);
+    }
+
+
+    /*********************sort**********************************************/
+    //sorts the chunks in parallel, then merges neighbouring runs in rounds,
+    //each round in parallel, through a buffer of the same size
+    template <typename IT, typename CMP>
+    void parallel_sort(IT first, IT last, CMP comp, thread_pool& pool = thread_pool::instance()){
+        typedef typename std::iterator_traits<IT>::value_type value_type;
+        uint64_t n = last - first;
+        uint64_t chunks = parallel_chunks(n, pool);
+        if(chunks == 1){
+            std::sort(first, last, comp);
+            return;
+        }
+        pool.parallel_for(chunks, [&](uint64_t c){
+            std::sort(first + chunk_begin(c, chunks, n), first + chunk_begin(c + 1, chunks, n), comp);
+        });
+
+        vector<value_type> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+        value_type* buf = buffer.data();
+        bool in_buffer = true;          //the sorted runs currently live in buf
+        for(uint64_t width = 1; width < chunks; width *= 2){
+            uint64_t pairs = (chunks + 2 * width - 1) / (2 * width);
+            pool.parallel_for(pairs, [&](uint64_t p){
+                uint64_t lo = chunk_begin(p * 2 * width, chunks, n);
+                uint64_t mid = chunk_begin(std::min(p * 2 * width + width, chunks), chunks, n);
+                uint64_t hi = chunk_begin(std::min(p * 2 * width + 2 * width, chunks), chunks, n);
+                if(in_buffer){
+                    std::merge(std::make_move_iterator(buf + lo), std::make_move_iterator(buf + mid),
+                               std::make_move_iterator(buf + mid), std::make_move_iterator(buf + hi),
+                               first + lo, comp);
+                }
+                else{
+                    std::merge(std::make_move_iterator(first + lo), std::make_move_iterator(first + mid),
+                               std::make_move_iterator(first + mid), std::make_move_iterator(first + hi),
+                               buf + lo, comp);
+                }
+            });
+            in_buffer = !in_buffer;
+        }
+        if(in_buffer){
+            pool.parallel_for(chunks, [&](uint64_t c){
+                uint64_t b = chunk_begin(c, chunks, n), e = chunk_begin(c + 1, chunks, n);
+                std::move(buf + b, buf + e, first + b);
+            });
+        }
+    }
+
+    template <typename IT>
+    void parallel_sort(IT first, IT last, thread_pool& pool = thread_pool::instance()){
+        typedef typename std::iterator_traits<IT>::value_type value_type;
+        parallel_sort(first, last, std::less<value_type>(), pool);
+    }
+
+    template <typename T, typename A, typename G>
+    void parallel_sort(vector<T, A, G>& v, thread_pool& pool = thread_pool::instance()){
+        parallel_sort(v.data(), v.data() + v.size(), std::less<T>(), pool);
+    }
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
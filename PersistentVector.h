@@ -0,0 +1,863 @@
+#ifndef _PERSISTENT_VECTOR_H_
+#define _PERSISTENT_VECTOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //An immutable sequence kept in a relaxed radix balanced (RRB) tree of
+    //32-way nodes. push_back, push_front, update, concat and slice leave the
+    //vector alone and return a new version that shares every node off the
+    //changed paths with it, so many versions of one large array cost memory
+    //in proportion to the edits between them, not to their number.
+    //
+    //Nodes are reference counted (atomically, so versions may be handed to
+    //other threads) and freed with the last version that uses them. Lookup
+    //is a radix descent of at most log32(n) steps; below a node that concat,
+    //slice or push_front left with a partly filled child it becomes a short
+    //scan of that node's table of subtree sizes.
+    //
+    //For many edits in a row, transient() gives a builder that changes the
+    //nodes only it can reach in place instead of copying them.
+    template <typename T, typename Alloc = allocator<T> >
+    class persistent_vector{
+    private:
+        static const unsigned bits = 5;
+        static const uint32_t width = uint32_t(1) << bits;
+        static const unsigned extra = 2;    //nodes a level may have beyond the fewest that would do
+
+        struct node{
+            std::atomic<uint32_t> refs;
+            uint32_t count;                 //elements in a leaf, children in an inner node
+        };
+
+        struct leaf : node{
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type items[width];
+            T* at(uint64_t k) { return reinterpret_cast<T*>(items + k); }
+        };
+
+        struct inner : node{
+            bool relaxed;                   //a child before the last is not full
+            node* kids[width];
+            uint64_t sizes[width];          //elements under kids[0] .. kids[k]
+        };
+
+        typedef typename std::allocator_traits<Alloc>::template rebind_alloc<leaf> leaf_allocator;
+        typedef typename std::allocator_traits<Alloc>::template rebind_alloc<inner> inner_allocator;
+
+        //a leaf is at shift 0; a node at shift s has children of up to 1 << s elements
+        node* root;
+        unsigned shift;
+        uint64_t length;
+        uint64_t assign_version;            //bumped when assignment replaces the tree
+        Alloc alloc;
+
+        void init(void){
+            root = nullptr;
+            shift = 0;
+            length = 0;
+            assign_version = 0;
+        }
+
+        /********************nodes***************************/
+        leaf* new_leaf(void){
+            leaf_allocator a(alloc);
+            leaf* l = a.allocate(1);
+            new(l) leaf;
+            l->refs.store(1, std::memory_order_relaxed);
+            l->count = 0;
+            return l;
+        }
+
+        inner* new_inner(void){
+            inner_allocator a(alloc);
+            inner* n = a.allocate(1);
+            new(n) inner;
+            n->refs.store(1, std::memory_order_relaxed);
+            n->count = 0;
+            n->relaxed = false;
+            return n;
+        }
+
+        static void retain(node* n) { n->refs.fetch_add(1, std::memory_order_relaxed); }
+
+        void release(node* n, unsigned s){
+            if(n->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+            if(s == 0){
+                leaf* l = static_cast<leaf*>(n);
+                for(uint64_t k = 0; k < l->count; k++) { l->at(k) -> ~T(); }
+                l->~leaf();
+                leaf_allocator(alloc).deallocate(l, 1);
+            }
+            else{
+                inner* in = static_cast<inner*>(n);
+                for(uint64_t k = 0; k < in->count; k++) { release(in->kids[k], s - bits); }
+                in->~inner();
+                inner_allocator(alloc).deallocate(in, 1);
+            }
+        }
+
+        //construct one more element at the end of a leaf that has room
+        template <typename... Args>
+        static void put(leaf* l, Args&&... args){
+            new(l->at(l->count)) T(std::forward<Args>(args)...);
+            l->count++;
+        }
+
+        //a new leaf holding copies of src's elements [first, last)
+        leaf* copy_leaf(leaf* src, uint64_t first, uint64_t last){
+            leaf* l = new_leaf();
+            try { for(uint64_t k = first; k < last; k++) { put(l, *src->at(k)); } }
+            catch(...) { release(l, 0); throw; }
+            return l;
+        }
+
+        //a new node sharing src's children
+        inner* copy_inner(inner* src){
+            inner* n = new_inner();
+            n->count = src->count;
+            n->relaxed = src->relaxed;
+            for(uint64_t k = 0; k < src->count; k++){
+                n->kids[k] = src->kids[k];
+                n->sizes[k] = src->sizes[k];
+                retain(n->kids[k]);
+            }
+            return n;
+        }
+
+        //A node that may be changed: n itself when a transient owns it
+        //outright, else a copy. The owner test is sound because a node is
+        //reached only through nodes that passed it first, top down.
+        inner* edit(inner* n, bool transient){
+            if(transient && n->refs.load(std::memory_order_acquire) == 1) { return n; }
+            return copy_inner(n);
+        }
+
+        static bool owned(node* n, bool transient){
+            return transient && n->refs.load(std::memory_order_acquire) == 1;
+        }
+
+        //put r where kids[k] was; n holds a reference to the old child
+        void replace(inner* n, uint64_t k, node* r, unsigned s){
+            if(r != n->kids[k]){
+                release(n->kids[k], s - bits);
+                n->kids[k] = r;
+            }
+        }
+
+        static uint64_t subtree_size(node* n, unsigned s){
+            if(s == 0) { return n->count; }
+            inner* in = static_cast<inner*>(n);
+            return in->sizes[in->count - 1];
+        }
+
+        //recompute the size table and whether radix lookup still holds
+        static void seal(inner* n, unsigned s){
+            uint64_t total = 0;
+            n->relaxed = false;
+            for(uint64_t k = 0; k < n->count; k++){
+                uint64_t size = subtree_size(n->kids[k], s - bits);
+                total += size;
+                n->sizes[k] = total;
+                if(k + 1 < n->count && size != (uint64_t(1) << s)) { n->relaxed = true; }
+            }
+        }
+
+        //seal() for a node whose children changed only at the back: the
+        //entries before the last two stay as they are
+        static void seal_back(inner* n, unsigned s){
+            uint64_t k = (n->count >= 2) ? n->count - 2 : 0;
+            uint64_t total = (k == 0) ? 0 : n->sizes[k - 1];
+            for(; k < n->count; k++){
+                uint64_t size = subtree_size(n->kids[k], s - bits);
+                total += size;
+                n->sizes[k] = total;
+                if(k + 1 < n->count && size != (uint64_t(1) << s)) { n->relaxed = true; }
+            }
+        }
+
+        //the child of n holding element i, with i made relative to it
+        static uint64_t locate(inner* n, unsigned s, uint64_t& i){
+            uint64_t k = i >> s;
+            if(n->relaxed) { while(n->sizes[k] <= i) { k++; } }
+            if(k != 0) { i -= n->sizes[k - 1]; }
+            return k;
+        }
+
+        //the leaf holding element i; first is the index of its first element
+        leaf* find_leaf(uint64_t i, uint64_t& first) const{
+            node* n = root;
+            first = i;
+            for(unsigned s = shift; s > 0; s -= bits){
+                inner* in = static_cast<inner*>(n);
+                n = in->kids[locate(in, s, i)];
+            }
+            first -= i;
+            return static_cast<leaf*>(n);
+        }
+
+        //a chain of single-child nodes from shift s down to a leaf holding x
+        template <typename X>
+        node* path(unsigned s, X&& x){
+            leaf* l = new_leaf();
+            try { put(l, std::forward<X>(x)); }
+            catch(...) { release(l, 0); throw; }
+            node* n = l;
+            for(unsigned t = bits; t <= s; t += bits){
+                inner* p;
+                try { p = new_inner(); }
+                catch(...) { release(n, t - bits); throw; }
+                p->kids[0] = n;
+                p->count = 1;
+                seal(p, t);
+                n = p;
+            }
+            return n;
+        }
+
+        //put r above the root as the second (or with front, the first) child
+        void grow_root(node* r, bool front){
+            inner* top;
+            try { top = new_inner(); }
+            catch(...) { release(r, shift); throw; }
+            top->kids[front ? 1 : 0] = root;
+            top->kids[front ? 0 : 1] = r;
+            top->count = 2;
+            seal(top, shift + bits);
+            root = top;
+            shift += bits;
+        }
+
+        //n (at shift s) under a new single-child node; takes n's reference
+        node* lift(node* n, unsigned s){
+            inner* p;
+            try { p = new_inner(); }
+            catch(...) { release(n, s); throw; }
+            p->kids[0] = n;
+            p->count = 1;
+            seal(p, s + bits);
+            return p;
+        }
+
+        //drop single-child nodes off the top
+        void trim(void){
+            while(shift > 0 && root->count == 1){
+                node* kid = static_cast<inner*>(root)->kids[0];
+                retain(kid);
+                release(root, shift);
+                root = kid;
+                shift -= bits;
+            }
+        }
+
+        /********************push***************************/
+        static bool room_back(node* n, unsigned s){
+            if(n->count < width) { return true; }
+            return s != 0 && room_back(static_cast<inner*>(n)->kids[width - 1], s - bits);
+        }
+
+        static bool room_front(node* n, unsigned s){
+            if(n->count < width) { return true; }
+            return s != 0 && room_front(static_cast<inner*>(n)->kids[0], s - bits);
+        }
+
+        //n with x appended; n must have room
+        template <typename X>
+        node* push_back_at(node* n, unsigned s, X&& x, bool transient){
+            if(s == 0){
+                leaf* l = static_cast<leaf*>(n);
+                if(owned(l, transient)) { put(l, std::forward<X>(x)); return l; }
+                leaf* c = copy_leaf(l, 0, l->count);
+                try { put(c, std::forward<X>(x)); }
+                catch(...) { release(c, 0); throw; }
+                return c;
+            }
+            inner* in = static_cast<inner*>(n);
+            inner* e = edit(in, transient);
+            try{
+                uint64_t last = e->count - 1;
+                if(room_back(e->kids[last], s - bits)){
+                    replace(e, last, push_back_at(e->kids[last], s - bits, std::forward<X>(x), transient), s);
+                }
+                else{
+                    e->kids[e->count] = path(s - bits, std::forward<X>(x));
+                    e->count++;
+                }
+            }
+            catch(...){
+                if(e != in) { release(e, s); }
+                throw;
+            }
+            seal_back(e, s);
+            return e;
+        }
+
+        //n with x put ahead of its first element; n must have room
+        template <typename X>
+        node* push_front_at(node* n, unsigned s, X&& x, bool transient){
+            if(s == 0){
+                leaf* l = static_cast<leaf*>(n);
+                bool move = owned(l, transient);
+                leaf* c = new_leaf();
+                try{
+                    put(c, std::forward<X>(x));
+                    for(uint64_t k = 0; k < l->count; k++){
+                        if(move) { put(c, std::move_if_noexcept(*l->at(k))); }
+                        else { put(c, *l->at(k)); }
+                    }
+                }
+                catch(...) { release(c, 0); throw; }
+                return c;
+            }
+            inner* in = static_cast<inner*>(n);
+            inner* e = edit(in, transient);
+            try{
+                if(room_front(e->kids[0], s - bits)){
+                    replace(e, 0, push_front_at(e->kids[0], s - bits, std::forward<X>(x), transient), s);
+                }
+                else{
+                    node* p = path(s - bits, std::forward<X>(x));
+                    for(uint64_t k = e->count; k != 0; k--) { e->kids[k] = e->kids[k - 1]; }
+                    e->kids[0] = p;
+                    e->count++;
+                }
+            }
+            catch(...){
+                if(e != in) { release(e, s); }
+                throw;
+            }
+            seal(e, s);
+            return e;
+        }
+
+        template <typename X>
+        void append_value(X&& x, bool transient){
+            if(root == nullptr) { root = path(0, std::forward<X>(x)); }
+            else if(!room_back(root, shift)) { grow_root(path(shift, std::forward<X>(x)), false); }
+            else{
+                node* r = push_back_at(root, shift, std::forward<X>(x), transient);
+                if(r != root) { release(root, shift); root = r; }
+            }
+            length++;
+        }
+
+        template <typename X>
+        void prepend_value(X&& x, bool transient){
+            if(root == nullptr) { root = path(0, std::forward<X>(x)); }
+            else if(!room_front(root, shift)) { grow_root(path(shift, std::forward<X>(x)), true); }
+            else{
+                node* r = push_front_at(root, shift, std::forward<X>(x), transient);
+                if(r != root) { release(root, shift); root = r; }
+            }
+            length++;
+        }
+
+        /********************update***************************/
+        template <typename X>
+        node* update_at(node* n, unsigned s, uint64_t i, X&& x, bool transient){
+            if(s == 0){
+                leaf* l = static_cast<leaf*>(n);
+                if(owned(l, transient)) { *l->at(i) = std::forward<X>(x); return l; }
+                leaf* c = new_leaf();
+                try{
+                    for(uint64_t k = 0; k < l->count; k++){
+                        if(k == i) { put(c, std::forward<X>(x)); }
+                        else { put(c, *l->at(k)); }
+                    }
+                }
+                catch(...) { release(c, 0); throw; }
+                return c;
+            }
+            inner* in = static_cast<inner*>(n);
+            inner* e = edit(in, transient);
+            try{
+                uint64_t k = locate(e, s, i);
+                replace(e, k, update_at(e->kids[k], s - bits, i, std::forward<X>(x), transient), s);
+            }
+            catch(...){
+                if(e != in) { release(e, s); }
+                throw;
+            }
+            return e;
+        }
+
+        template <typename X>
+        void set_value(uint64_t i, X&& x, bool transient){
+            if(i >= length) { throw std::out_of_range{"subscript out of range"}; }
+            node* r = update_at(root, shift, i, std::forward<X>(x), transient);
+            if(r != root) { release(root, shift); root = r; }
+        }
+
+        /********************slice***************************/
+        //a new reference to the first n elements of the subtree (n > 0)
+        node* take_at(node* n, unsigned s, uint64_t keep){
+            if(keep == subtree_size(n, s)) { retain(n); return n; }
+            if(s == 0) { return copy_leaf(static_cast<leaf*>(n), 0, keep); }
+            inner* in = static_cast<inner*>(n);
+            uint64_t i = keep - 1;
+            uint64_t k = locate(in, s, i);
+            inner* p = new_inner();
+            for(; p->count < k; p->count++){
+                p->kids[p->count] = in->kids[p->count];
+                retain(p->kids[p->count]);
+            }
+            try { p->kids[k] = take_at(in->kids[k], s - bits, i + 1); }
+            catch(...) { release(p, s); throw; }
+            p->count = k + 1;
+            seal(p, s);
+            return p;
+        }
+
+        //a new reference to the subtree without its first n elements (n < size)
+        node* drop_at(node* n, unsigned s, uint64_t skip){
+            if(skip == 0) { retain(n); return n; }
+            if(s == 0) { return copy_leaf(static_cast<leaf*>(n), skip, n->count); }
+            inner* in = static_cast<inner*>(n);
+            uint64_t k = locate(in, s, skip);
+            inner* p = new_inner();
+            try { p->kids[0] = drop_at(in->kids[k], s - bits, skip); }
+            catch(...) { release(p, s); throw; }
+            for(p->count = 1; k + p->count < in->count; p->count++){
+                p->kids[p->count] = in->kids[k + p->count];
+                retain(p->kids[p->count]);
+            }
+            seal(p, s);
+            return p;
+        }
+
+        /********************concat***************************/
+        //Repacks a run of sibling nodes (at shift s) that has more than extra
+        //nodes beyond the fewest that could hold their contents: from the
+        //first node that is not nearly full, contents are moved left into
+        //full nodes. This keeps the relaxed nodes dense enough that lookup
+        //scans stay short. Returns the new number of nodes.
+        uint64_t rebalance(node** list, uint64_t n, unsigned s){
+            uint64_t slots = 0;
+            for(uint64_t k = 0; k < n; k++) { slots += list[k]->count; }
+            uint64_t fewest = (slots + width - 1) / width;
+            if(n <= fewest + extra) { return n; }
+            uint64_t first = 0;
+            while(first < n && list[first]->count >= width - extra / 2) { slots -= list[first]->count; first++; }
+
+            node* packed[2 * width + 2];
+            uint64_t made = 0;
+            try{
+                for(uint64_t k = first; k < n; k++){
+                    for(uint64_t j = 0; j < list[k]->count; j++){
+                        if(made == 0 || packed[made - 1]->count == width){
+                            packed[made] = (s == 0) ? static_cast<node*>(new_leaf()) : static_cast<node*>(new_inner());
+                            made++;
+                        }
+                        node* dst = packed[made - 1];
+                        if(s == 0) { put(static_cast<leaf*>(dst), *static_cast<leaf*>(list[k])->at(j)); }
+                        else{
+                            node* kid = static_cast<inner*>(list[k])->kids[j];
+                            retain(kid);
+                            static_cast<inner*>(dst)->kids[dst->count++] = kid;
+                        }
+                    }
+                }
+            }
+            catch(...){
+                for(uint64_t k = 0; k < made; k++) { release(packed[k], s); }
+                throw;
+            }
+            for(uint64_t k = first; k < n; k++) { release(list[k], s); }
+            for(uint64_t k = 0; k < made; k++){
+                if(s != 0) { seal(static_cast<inner*>(packed[k]), s); }
+                list[first + k] = packed[k];
+            }
+            return first + made;
+        }
+
+        //Nodes (one or two, new references, written to out) at shift s that
+        //hold the elements of l followed by those of r, both at shift s.
+        uint64_t merge(node* l, node* r, unsigned s, node** out){
+            if(s == 0){
+                retain(l); retain(r);
+                out[0] = l; out[1] = r;
+                return 2;
+            }
+            inner* left = static_cast<inner*>(l);
+            inner* right = static_cast<inner*>(r);
+            node* all[2 * width + 2];
+            uint64_t n = 0;
+            for(uint64_t k = 0; k + 1 < left->count; k++) { retain(left->kids[k]); all[n++] = left->kids[k]; }
+            try { n += merge(left->kids[left->count - 1], right->kids[0], s - bits, all + n); }
+            catch(...) { while(n != 0) { release(all[--n], s - bits); } throw; }
+            for(uint64_t k = 1; k < right->count; k++) { retain(right->kids[k]); all[n++] = right->kids[k]; }
+
+            uint64_t made = 0;
+            try{
+                n = rebalance(all, n, s - bits);
+                for(uint64_t first = 0; first < n; first += width){
+                    out[made] = new_inner();
+                    made++;
+                }
+            }
+            catch(...){
+                for(uint64_t k = 0; k < made; k++) { release(out[k], s); }
+                for(uint64_t k = 0; k < n; k++) { release(all[k], s - bits); }
+                throw;
+            }
+            for(uint64_t k = 0; k < n; k++){
+                inner* p = static_cast<inner*>(out[k / width]);
+                p->kids[p->count++] = all[k];
+            }
+            for(uint64_t k = 0; k < made; k++) { seal(static_cast<inner*>(out[k]), s); }
+            return made;
+        }
+
+        /********************bulk***************************/
+        //builds the tree bottom up from n contiguous elements, every node full
+        void build(const T* p, uint64_t n){
+            if(n == 0) { return; }
+            vector<node*> level;
+            vector<node*> up;
+            unsigned s = 0;
+            try{
+                level.reserve((n + width - 1) / width);
+                for(uint64_t i = 0; i < n; i += width){
+                    leaf* l = new_leaf();
+                    level.push_back(l);
+                    for(uint64_t k = i; k < n && k < i + width; k++) { put(l, p[k]); }
+                }
+                while(level.size() > 1){
+                    up.reserve((level.size() + width - 1) / width);
+                    for(uint64_t i = 0; i < level.size(); i += width){
+                        inner* in = new_inner();
+                        up.push_back(in);
+                        for(uint64_t k = i; k < level.size() && k < i + width; k++){
+                            in->kids[in->count++] = level[k];
+                            level[k] = nullptr;
+                        }
+                        seal(in, s + bits);
+                    }
+                    level = std::move(up);
+                    up.clear();
+                    s += bits;
+                }
+            }
+            catch(...){
+                for(uint64_t k = 0; k < level.size(); k++) { if(level[k] != nullptr) { release(level[k], s); } }
+                for(uint64_t k = 0; k < up.size(); k++) { release(up[k], s + bits); }
+                throw;
+            }
+            root = level[0];
+            shift = s;
+            length = n;
+        }
+
+        template <typename F>
+        void visit(node* n, unsigned s, F& f) const{
+            if(s == 0){
+                leaf* l = static_cast<leaf*>(n);
+                f(static_cast<const T*>(l->at(0)), static_cast<const T*>(l->at(l->count)));
+                return;
+            }
+            inner* in = static_cast<inner*>(n);
+            for(uint64_t k = 0; k < in->count; k++) { visit(in->kids[k], s - bits, f); }
+        }
+
+    public:
+        typedef T value_type;
+        typedef Alloc allocator_type;
+
+        persistent_vector(void) { init(); }
+
+        explicit persistent_vector(const Alloc& a) : alloc(a) { init(); }
+
+        persistent_vector(std::initializer_list<T> i1, const Alloc& a = Alloc()) : alloc(a) {
+            init();
+            build(i1.begin(), i1.size());
+        }
+
+        template <typename IT>
+        persistent_vector(IT b, IT e, const Alloc& a = Alloc()) : alloc(a) {
+            init();
+            try { for(; b != e; ++b) { append_value(*b, true); } }
+            catch(...) { if(root != nullptr) { release(root, shift); } throw; }
+        }
+
+        //bulk conversion: one pass over v's contiguous storage
+        template <typename A, typename G>
+        explicit persistent_vector(const vector<T, A, G>& v, const Alloc& a = Alloc()) : alloc(a) {
+            init();
+            build(v.data(), v.size());
+        }
+
+        persistent_vector(const persistent_vector& that) : alloc(that.alloc) {
+            init();
+            root = that.root;
+            shift = that.shift;
+            length = that.length;
+            if(root != nullptr) { retain(root); }
+        }
+
+        persistent_vector(persistent_vector&& that) : alloc(that.alloc) {
+            init();
+            root = that.root;
+            shift = that.shift;
+            length = that.length;
+            that.init();
+        }
+
+        persistent_vector& operator=(const persistent_vector& that){
+            if(this != &that){
+                if(that.root != nullptr) { retain(that.root); }
+                if(root != nullptr) { release(root, shift); }
+                alloc = that.alloc;
+                root = that.root;
+                shift = that.shift;
+                length = that.length;
+            }
+            assign_version++;
+            return *this;
+        }
+
+        persistent_vector& operator=(persistent_vector&& that){
+            if(this != &that){
+                if(root != nullptr) { release(root, shift); }
+                alloc = that.alloc;
+                root = that.root;
+                shift = that.shift;
+                length = that.length;
+                that.root = nullptr;
+                that.shift = 0;
+                that.length = 0;
+            }
+            assign_version++;
+            return *this;
+        }
+
+        ~persistent_vector(void){
+            if(root != nullptr) { release(root, shift); }
+        }
+
+        uint64_t size(void) const { return length; }
+        bool empty(void) const { return length == 0; }
+
+        const T& operator[](uint64_t k) const{
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            uint64_t first;
+            return *find_leaf(k, first)->at(k - first);
+        }
+
+        /**********************new versions*********************************/
+        persistent_vector push_back(const T& x) const { persistent_vector v(*this); v.append_value(x, false); return v; }
+        persistent_vector push_back(T&& x) const { persistent_vector v(*this); v.append_value(std::move(x), false); return v; }
+        persistent_vector push_front(const T& x) const { persistent_vector v(*this); v.prepend_value(x, false); return v; }
+        persistent_vector push_front(T&& x) const { persistent_vector v(*this); v.prepend_value(std::move(x), false); return v; }
+
+        //this version with element k replaced by x
+        persistent_vector update(uint64_t k, const T& x) const { persistent_vector v(*this); v.set_value(k, x, false); return v; }
+        persistent_vector update(uint64_t k, T&& x) const { persistent_vector v(*this); v.set_value(k, std::move(x), false); return v; }
+
+        //this version followed by that one, in O(log n) node copies
+        persistent_vector concat(const persistent_vector& that) const{
+            if(that.length == 0) { return *this; }
+            if(length == 0) { return that; }
+            persistent_vector v(alloc);
+            node* l = root;
+            node* r = that.root;
+            retain(l); retain(r);
+            unsigned ls = shift, rs = that.shift;
+            try{
+                //bring both to one height under chains of single-child nodes
+                for(; ls < rs; ls += bits) { node* t = l; l = nullptr; l = v.lift(t, ls); }
+                for(; rs < ls; rs += bits) { node* t = r; r = nullptr; r = v.lift(t, rs); }
+                node* out[2];
+                uint64_t made;
+                if(ls == 0){
+                    out[0] = l; out[1] = r;
+                    l = r = nullptr;
+                    made = 2;
+                    try { made = v.rebalance(out, 2, 0); }
+                    catch(...) { v.release(out[0], 0); v.release(out[1], 0); throw; }
+                }
+                else{
+                    made = v.merge(l, r, ls, out);
+                    v.release(l, ls); v.release(r, ls);
+                    l = r = nullptr;
+                }
+                v.root = out[0];
+                v.shift = ls;
+                if(made == 2) { v.grow_root(out[1], false); }
+            }
+            catch(...){
+                if(l != nullptr) { v.release(l, ls); }
+                if(r != nullptr) { v.release(r, rs); }
+                throw;
+            }
+            v.length = length + that.length;
+            v.trim();
+            return v;
+        }
+
+        //elements [first, last) of this version
+        persistent_vector slice(uint64_t first, uint64_t last) const{
+            if(first > last || last > length) { throw std::out_of_range{"slice out of range"}; }
+            persistent_vector v(alloc);
+            if(first == last) { return v; }
+            v.root = v.take_at(root, shift, last);
+            v.shift = shift;
+            v.length = last;
+            if(first != 0){
+                node* r = v.drop_at(v.root, v.shift, first);
+                v.release(v.root, v.shift);
+                v.root = r;
+                v.length -= first;
+            }
+            v.trim();
+            return v;
+        }
+
+        /**********************conversion*********************************/
+        //calls f(const T* first, const T* last) on each leaf's elements in order
+        template <typename F>
+        void for_each_leaf(F f) const{
+            if(root != nullptr) { visit(root, shift, f); }
+        }
+
+        //an epl::vector of the elements, allocated once at its final size
+        template <typename A = allocator<T>, typename G = double_growth>
+        vector<T, A, G> to_vector(void) const{
+            vector<T, A, G> v;
+            v.reserve(length);
+            for_each_leaf([&v](const T* first, const T* last) { v.append(first, last); });
+            return v;
+        }
+
+        /**********************transient builder*********************************/
+        //A mutable vector over the same tree for a batch of edits. Nodes the
+        //builder made and still alone holds are changed in place; the ones
+        //shared with a persistent version are copied once, on first write.
+        //persistent() hands out the current state as a persistent version,
+        //after which the builder copies again before changing shared nodes.
+        class builder{
+        private:
+            persistent_vector tree;
+
+            friend class persistent_vector;
+            explicit builder(const persistent_vector& v) : tree(v) {}
+
+        public:
+            builder(void) {}
+
+            uint64_t size(void) const { return tree.length; }
+            bool empty(void) const { return tree.length == 0; }
+            const T& operator[](uint64_t k) const { return tree[k]; }
+
+            void push_back(const T& x) { tree.append_value(x, true); }
+            void push_back(T&& x) { tree.append_value(std::move(x), true); }
+            void push_front(const T& x) { tree.prepend_value(x, true); }
+            void push_front(T&& x) { tree.prepend_value(std::move(x), true); }
+
+            void set(uint64_t k, const T& x) { tree.set_value(k, x, true); }
+            void set(uint64_t k, T&& x) { tree.set_value(k, std::move(x), true); }
+
+            persistent_vector persistent(void) const { return tree; }
+        };
+
+        builder transient(void) const { return builder(*this); }
+
+        /**********************iterator class*********************************/
+        //An index into a version, with the leaf under it cached so that
+        //stepping through a leaf costs no descent. Versions never change, so
+        //only assigning to the persistent_vector invalidates it (MODERATE).
+        class const_iterator{
+        private:
+            const persistent_vector* parent;
+            int64_t index;
+            mutable const T* items;         //the cached leaf, holding [first, last)
+            mutable int64_t first;
+            mutable int64_t last;
+#if EPL_CHECKED_ITERATORS
+            uint64_t iterator_version;
+#endif
+
+            const T* element(int64_t i) const{
+                if(i < first || i >= last){
+                    uint64_t f;
+                    leaf* l = parent->find_leaf(i, f);
+                    items = l->at(0);
+                    first = f;
+                    last = f + l->count;
+                }
+                return items + (i - first);
+            }
+
+        public:
+            typedef T value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T* pointer;
+            typedef const T& reference;
+
+            const_iterator(void) { parent = nullptr; index = 0; items = nullptr; first = last = 0; set_version(); }
+
+            const_iterator(const persistent_vector* parent, int64_t index){
+                this->parent = parent;
+                this->index = index;
+                items = nullptr;
+                first = last = 0;
+                set_version();
+            }
+
+            reference operator*(void) const { check_exception(); return *element(index); }
+            pointer operator->(void) const { check_exception(); return element(index); }
+            reference operator[](int64_t k) const { check_exception(); return *element(index + k); }
+
+            const_iterator& operator++() { index++; return *this; }
+            const_iterator operator++(int) { const_iterator tmp{*this}; index++; return tmp; }
+            const_iterator& operator--() { index--; return *this; }
+            const_iterator operator--(int) { const_iterator tmp{*this}; index--; return tmp; }
+
+            const_iterator& operator+=(int64_t k) { index += k; return *this; }
+            const_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            const_iterator operator+(int64_t k) const { const_iterator tmp{*this}; tmp.index += k; return tmp; }
+            const_iterator operator-(int64_t k) const { const_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            int64_t operator-(const const_iterator& it) const { return index - it.index; }
+
+            bool operator==(const const_iterator& it) const { check_exception(); return index == it.index; }
+            bool operator!=(const const_iterator& it) const { return !(*this == it); }
+            bool operator<(const const_iterator& it) const { return index < it.index; }
+            bool operator>(const const_iterator& it) const { return index > it.index; }
+            bool operator<=(const const_iterator& it) const { return index <= it.index; }
+            bool operator>=(const const_iterator& it) const { return index >= it.index; }
+
+#if EPL_CHECKED_ITERATORS
+            void set_version(void) { iterator_version = parent ? parent->assign_version : 0; }
+
+            void check_exception() const{
+                if(parent != nullptr && iterator_version != parent->assign_version)
+                    throw epl::invalid_iterator{    epl::invalid_iterator::MODERATE  };
+            }
+#else
+            void set_version(void) {}
+            void check_exception() const {}
+#endif
+        };
+
+        typedef const_iterator iterator;
+
+        const_iterator begin(void) const { return const_iterator(this, 0); }
+        const_iterator end(void) const { return const_iterator(this, length); }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef _SEGMENTED_VECTOR_H_
+#define _SEGMENTED_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //elements per block: about a page worth, a power of two, at least 8
+    template <typename T>
+    struct segment_size{
+        static constexpr uint64_t fit(uint64_t n, uint64_t p){
+            return (p * 2 > n) ? p : fit(n, p * 2);
+        }
+        static constexpr uint64_t value = (sizeof(T) * 8 >= 4096) ? 8 : fit(4096 / sizeof(T), 8);
+    };
+
+    //A double-ended sequence kept in fixed-size blocks that are listed in a
+    //small directory (an epl::vector of block pointers). Growth at either end
+    //adds a block and touches only the directory, so elements never move:
+    //pointers and references to them stay valid until the element is popped.
+    //Indexing is two loads, one into the directory and one into the block.
+    //Moves only take the directory, and are noexcept.
+    template <typename T, uint64_t B = segment_size<T>::value, typename Alloc = allocator<T> >
+    class segmented_vector{
+    private:
+        static_assert(B != 0 && (B & (B - 1)) == 0, "block size must be a power of two");
+
+        typedef typename std::allocator_traits<Alloc>::template rebind_alloc<T*> directory_allocator;
+
+        vector<T*, directory_allocator> blocks;
+        uint64_t head;              //unused slots ahead of the first element in blocks[0]
+        uint64_t length;
+        uint64_t front_version;     //bumped when indexes shift (front push/pop)
+        T* spare;                   //one emptied block kept to avoid thrashing at a boundary
+        Alloc alloc;
+
+        //the block pointers, read through the const data() so that indexes
+        //already known to be valid pay no bounds check
+        T* const* directory(void) const { return static_cast<const vector<T*, directory_allocator>&>(blocks).data(); }
+
+        T* slot(uint64_t k) const{
+            uint64_t pos = head + k;
+            return directory()[pos / B] + (pos & (B - 1));
+        }
+
+        T* new_block(void){
+            if(spare != nullptr){
+                T* b = spare;
+                spare = nullptr;
+                return b;
+            }
+            return alloc.allocate(B);
+        }
+
+        void release_block(T* b){
+            if(spare == nullptr) { spare = b; }
+            else { alloc.deallocate(b, B); }
+        }
+
+        void init(void){
+            head = 0;
+            length = 0;
+            front_version = 0;
+            spare = nullptr;
+        }
+
+    public:
+        typedef T value_type;
+        typedef Alloc allocator_type;
+
+        segmented_vector(void) { init(); }
+
+        explicit segmented_vector(const Alloc& a) : blocks(directory_allocator(a)), alloc(a) { init(); }
+
+        explicit segmented_vector(uint64_t n, const Alloc& a = Alloc()) : blocks(directory_allocator(a)), alloc(a) {
+            init();
+            for(uint64_t k = 0; k < n; k++) { emplace_back(); }
+        }
+
+        segmented_vector(std::initializer_list<T> i1, const Alloc& a = Alloc()) : blocks(directory_allocator(a)), alloc(a) {
+            init();
+            for(auto iter = i1.begin(); iter != i1.end(); ++iter) { push_back(*iter); }
+        }
+
+        template<typename IT>
+        segmented_vector(IT b, IT e, const Alloc& a = Alloc()) : blocks(directory_allocator(a)), alloc(a) {
+            init();
+            for(; b != e; ++b) { emplace_back(*b); }
+        }
+
+        segmented_vector(const segmented_vector& that) : blocks(that.blocks.get_allocator()), alloc(that.alloc) {
+            init();
+            for(uint64_t k = 0; k < that.length; k++) { push_back(*that.slot(k)); }
+        }
+
+        segmented_vector(segmented_vector&& that) noexcept : blocks(std::move(that.blocks)), alloc(that.alloc) {
+            head = that.head; length = that.length; spare = that.spare;
+            front_version = 0;
+            that.init();
+        }
+
+        segmented_vector& operator=(const segmented_vector& that){
+            if(this != &that){
+                clear();
+                for(uint64_t k = 0; k < that.length; k++) { push_back(*that.slot(k)); }
+            }
+            front_version++;
+            return *this;
+        }
+
+        segmented_vector& operator=(segmented_vector&& that) noexcept{
+            if(this != &that){
+                clear();
+                if(spare != nullptr) { alloc.deallocate(spare, B); }
+                blocks = std::move(that.blocks);
+                alloc = that.alloc;
+                head = that.head; length = that.length; spare = that.spare;
+                that.init();
+            }
+            front_version++;
+            return *this;
+        }
+
+        ~segmented_vector(void){
+            clear();
+            if(spare != nullptr) { alloc.deallocate(spare, B); }
+        }
+
+        uint64_t size(void) const { return length; }
+        bool empty(void) const { return length == 0; }
+        static constexpr uint64_t block_size(void) { return B; }
+
+        T& operator[](uint64_t k){
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            return *slot(k);
+        }
+
+        const T& operator[](uint64_t k) const{
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            return *slot(k);
+        }
+
+        void push_back(const T& that) { emplace_back(that); }
+        void push_back(T&& that) { emplace_back(std::move(that)); }
+        void push_front(const T& that) { emplace_front(that); }
+        void push_front(T&& that) { emplace_front(std::move(that)); }
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args){
+            uint64_t pos = head + length;
+            if(pos / B == blocks.size()){
+                //list the block first: once the element is built, nothing
+                //that can throw is left
+                T* b = new_block();
+                try { blocks.push_back(b); }
+                catch(...) { release_block(b); throw; }
+                try { new(b) T(std::forward<Args>(args)...); }
+                catch(...) { blocks.pop_back(); release_block(b); throw; }
+            }
+            else{
+                new(directory()[pos / B] + (pos & (B - 1))) T(std::forward<Args>(args)...);
+            }
+            length++;
+            return *slot(length - 1);
+        }
+
+        template <typename... Args>
+        T& emplace_front(Args&&... args){
+            if(blocks.size() == 0 || head == 0){
+                T* b = new_block();
+                try { blocks.push_front(b); }
+                catch(...) { release_block(b); throw; }
+                try { new(b + B - 1) T(std::forward<Args>(args)...); }
+                catch(...) { blocks.pop_front(); release_block(b); throw; }
+                head = B - 1;
+            }
+            else{
+                new(directory()[0] + head - 1) T(std::forward<Args>(args)...);
+                head--;
+            }
+            length++;
+            front_version++;
+            return *slot(0);
+        }
+
+        void pop_back(void){
+            if(length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            slot(length - 1) -> ~T();
+            length--;
+            uint64_t end = head + length;
+            if(end % B == 0 && blocks.size() > end / B){
+                release_block(directory()[blocks.size() - 1]);
+                blocks.pop_back();
+                if(blocks.size() == 0) { head = 0; }
+            }
+        }
+
+        void pop_front(void){
+            if(length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            slot(0) -> ~T();
+            head++;
+            length--;
+            if(head == B || length == 0){
+                if(head == B || blocks.size() == 1){
+                    release_block(directory()[0]);
+                    blocks.pop_front();
+                }
+                head = 0;
+            }
+            front_version++;
+        }
+
+        void clear(void){
+            if(!std::is_trivially_destructible<T>::value){
+                for(uint64_t k = 0; k < length; k++) { slot(k) -> ~T(); }
+            }
+            for(uint64_t k = 0; k < blocks.size(); k++) { release_block(directory()[k]); }
+            blocks.clear();
+            head = 0;
+            length = 0;
+            front_version++;
+        }
+
+        //calls f(T* first, T* last) on each contiguous run of elements in
+        //order; the fast way to scan every element
+        template <typename F>
+        void for_each_segment(F f){
+            uint64_t k = 0;
+            while(k < length){
+                T* first = slot(k);
+                uint64_t n = B - ((head + k) & (B - 1));
+                if(n > length - k) { n = length - k; }
+                f(first, first + n);
+                k += n;
+            }
+        }
+
+        /**********************iterator class*********************************/
+        //An index into the container. Pushing at the back never invalidates
+        //it; pushing or popping at the front shifts every index, which a
+        //checked iterator reports as a MILD invalid_iterator.
+        template <bool Const>
+        class basic_iterator{
+        private:
+            typedef typename std::conditional<Const, const segmented_vector, segmented_vector>::type container;
+            container* parent;
+            int64_t index;
+#if EPL_CHECKED_ITERATORS
+            uint64_t iterator_version;
+#endif
+
+            friend class segmented_vector;
+            template <bool> friend class basic_iterator;
+
+        public:
+            typedef T value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<Const, const T*, T*>::type pointer;
+            typedef typename std::conditional<Const, const T&, T&>::type reference;
+
+            basic_iterator(void) { parent = nullptr; index = 0; set_version(); }
+
+            basic_iterator(container* parent, int64_t index){
+                this->parent = parent;
+                this->index = index;
+                set_version();
+            }
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            basic_iterator(const basic_iterator<C>& it){
+                parent = it.parent;
+                index = it.index;
+#if EPL_CHECKED_ITERATORS
+                iterator_version = it.iterator_version;
+#endif
+            }
+
+            reference operator*(void) const { check_exception(); return *parent->slot(index); }
+            pointer operator->(void) const { check_exception(); return parent->slot(index); }
+            reference operator[](int64_t k) const { check_exception(); return *parent->slot(index + k); }
+
+            basic_iterator& operator++() { index++; return *this; }
+            basic_iterator operator++(int) { basic_iterator tmp{*this}; index++; return tmp; }
+            basic_iterator& operator--() { index--; return *this; }
+            basic_iterator operator--(int) { basic_iterator tmp{*this}; index--; return tmp; }
+
+            basic_iterator& operator+=(int64_t k) { index += k; return *this; }
+            basic_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            basic_iterator operator+(int64_t k) const { basic_iterator tmp{*this}; tmp.index += k; return tmp; }
+            basic_iterator operator-(int64_t k) const { basic_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            int64_t operator-(const basic_iterator& it) const { return index - it.index; }
+
+            bool operator==(const basic_iterator& it) const { check_exception(); return index == it.index; }
+            bool operator!=(const basic_iterator& it) const { return !(*this == it); }
+            bool operator<(const basic_iterator& it) const { return index < it.index; }
+            bool operator>(const basic_iterator& it) const { return index > it.index; }
+            bool operator<=(const basic_iterator& it) const { return index <= it.index; }
+            bool operator>=(const basic_iterator& it) const { return index >= it.index; }
+
+#if EPL_CHECKED_ITERATORS
+            void set_version(void) { iterator_version = parent ? parent->front_version : 0; }
+
+            void check_exception() const{
+                if(parent != nullptr && iterator_version != parent->front_version)
+                    throw epl::invalid_iterator{    epl::invalid_iterator::MILD  };
+            }
+#else
+            void set_version(void) {}
+            void check_exception() const {}
+#endif
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        iterator begin(void) { return iterator(this, 0); }
+        iterator end(void) { return iterator(this, length); }
+        const_iterator begin(void) const { return const_iterator(this, 0); }
+        const_iterator end(void) const { return const_iterator(this, length); }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef _SERIALIZE_H_
+#define _SERIALIZE_H_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define EPL_HAS_MMAP_FILES 1
+#else
+#define EPL_HAS_MMAP_FILES 0
+#endif
+
+#include "Vector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //On-disk layout: this 64-byte header, padding up to data_offset, then
+    //count * elem_size bytes of elements exactly as they sit in memory.
+    //The file is only readable on a machine with the same byte order and
+    //the same layout of T, which the header checks as far as it can.
+    struct file_header{
+        char magic[8];              //"EPLVEC\0\1"
+        uint32_t byte_order;        //0x01020304 as written
+        uint32_t elem_size;
+        uint64_t count;
+        uint64_t align;
+        uint64_t data_offset;
+        uint64_t checksum;          //of the element bytes, see checksum()
+        uint64_t reserved[2];
+
+        static const char* expected_magic(void) { return "EPLVEC\0\1"; }
+    };
+
+    static_assert(sizeof(file_header) == 64, "file_header must stay 64 bytes");
+
+    //64-bit FNV-1a over 8-byte words, then the tail bytes
+    inline uint64_t checksum(const void* p, uint64_t n){
+        const unsigned char* b = static_cast<const unsigned char*>(p);
+        uint64_t h = 14695981039346656037ull;
+        uint64_t k = 0;
+        for(; k + 8 <= n; k += 8){
+            uint64_t w;
+            std::memcpy(&w, b + k, 8);
+            h = (h ^ w) * 1099511628211ull;
+        }
+        for(; k < n; k++) { h = (h ^ b[k]) * 1099511628211ull; }
+        return h;
+    }
+
+    //Writes v to path. The file is written beside path and renamed over
+    //it, so readers never see a half-written snapshot.
+    template <typename T, typename A, typename G>
+    void save(const vector<T, A, G>& v, const std::string& path){
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable elements can be saved");
+        file_header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, file_header::expected_magic(), sizeof(h.magic));
+        h.byte_order = 0x01020304;
+        h.elem_size = sizeof(T);
+        h.count = v.size();
+        h.align = alignof(T);
+        h.data_offset = (sizeof(file_header) + alignof(T) - 1) / alignof(T) * alignof(T);
+        h.checksum = checksum(v.data(), v.size() * sizeof(T));
+
+        std::string tmp = path + ".tmp";
+        std::FILE* f = std::fopen(tmp.c_str(), "wb");
+        if(f == nullptr) { throw std::system_error(errno, std::generic_category(), "cannot create " + tmp); }
+        static const char zeros[64] = {};
+        uint64_t pad = h.data_offset - sizeof(h);
+        bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1
+               && (pad == 0 || std::fwrite(zeros, pad, 1, f) == 1)
+               && (v.size() == 0 || std::fwrite(v.data(), sizeof(T), v.size(), f) == v.size());
+        ok = (std::fclose(f) == 0) && ok;
+        if(!ok || std::rename(tmp.c_str(), path.c_str()) != 0){
+            int e = errno;
+            std::remove(tmp.c_str());
+            throw std::system_error(e, std::generic_category(), "cannot write " + path);
+        }
+    }
+
+    //A vector saved by save(), mapped straight from its file instead of
+    //being read and copied: opening costs one mmap, and each page is
+    //faulted in the first time it is touched.
+    //
+    //mapped_vector<const T> maps the file shared and read-only.
+    //mapped_vector<T> maps it private and writable: pages written to are
+    //copied for this process and the file itself never changes. The
+    //checksum is not verified on open, as that would touch every page;
+    //call verify() when the file may be damaged.
+    template <typename T>
+    class mapped_vector{
+    private:
+        typedef typename std::remove_const<T>::type element;
+
+        static_assert(std::is_trivially_copyable<element>::value, "only trivially copyable elements can be mapped");
+        static const bool writable = !std::is_const<T>::value;
+
+        void* base;
+        uint64_t mapped_bytes;
+        T* first;
+        uint64_t length;
+        uint64_t expected_checksum;
+
+        void init(void){
+            base = nullptr;
+            mapped_bytes = 0;
+            first = nullptr;
+            length = 0;
+            expected_checksum = 0;
+        }
+
+        void unmap(void){
+#if EPL_HAS_MMAP_FILES
+            if(base != nullptr) { munmap(base, mapped_bytes); }
+#endif
+            init();
+        }
+
+        static void bad_file(const std::string& path, const char* why){
+            throw std::runtime_error{path + ": " + why};
+        }
+
+    public:
+        typedef element value_type;
+
+        mapped_vector(void) { init(); }
+
+        explicit mapped_vector(const std::string& path){
+            init();
+#if EPL_HAS_MMAP_FILES
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) { throw std::system_error(errno, std::generic_category(), "cannot open " + path); }
+            struct stat st;
+            if(fstat(fd, &st) != 0){
+                int e = errno;
+                ::close(fd);
+                throw std::system_error(e, std::generic_category(), "cannot stat " + path);
+            }
+            uint64_t file_size = st.st_size;
+            if(file_size < sizeof(file_header)){
+                ::close(fd);
+                bad_file(path, "too short for a header");
+            }
+            int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+            int flags = writable ? MAP_PRIVATE : MAP_SHARED;
+            void* p = mmap(nullptr, file_size, prot, flags, fd, 0);
+            int e = errno;
+            ::close(fd);
+            if(p == MAP_FAILED) { throw std::system_error(e, std::generic_category(), "cannot map " + path); }
+            base = p;
+            mapped_bytes = file_size;
+
+            file_header h;
+            std::memcpy(&h, base, sizeof(h));
+            const char* why = nullptr;
+            if(std::memcmp(h.magic, file_header::expected_magic(), sizeof(h.magic)) != 0) { why = "not a saved epl::vector"; }
+            else if(h.byte_order != 0x01020304) { why = "written with a different byte order"; }
+            else if(h.elem_size != sizeof(T) || h.align != alignof(T)) { why = "element size or alignment does not match"; }
+            else if(h.data_offset < sizeof(h) || h.data_offset % alignof(T) != 0 || h.data_offset > file_size
+                    || h.count > (file_size - h.data_offset) / sizeof(T)) { why = "truncated or damaged"; }
+            if(why != nullptr){
+                unmap();
+                bad_file(path, why);
+            }
+            first = reinterpret_cast<T*>(static_cast<char*>(base) + h.data_offset);
+            length = h.count;
+            expected_checksum = h.checksum;
+#else
+            bad_file(path, "memory-mapped files are not supported on this platform");
+#endif
+        }
+
+        mapped_vector(const mapped_vector&) = delete;
+        mapped_vector& operator=(const mapped_vector&) = delete;
+
+        mapped_vector(mapped_vector&& that){
+            base = that.base; mapped_bytes = that.mapped_bytes;
+            first = that.first; length = that.length;
+            expected_checksum = that.expected_checksum;
+            that.init();
+        }
+
+        mapped_vector& operator=(mapped_vector&& that){
+            if(this != &that){
+                unmap();
+                base = that.base; mapped_bytes = that.mapped_bytes;
+                first = that.first; length = that.length;
+                expected_checksum = that.expected_checksum;
+                that.init();
+            }
+            return *this;
+        }
+
+        ~mapped_vector(void) { unmap(); }
+
+        uint64_t size(void) const { return length; }
+        bool empty(void) const { return length == 0; }
+
+        T* data(void) const { return first; }
+
+        T& operator[](uint64_t k) const{
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            return first[k];
+        }
+
+        T* begin(void) const { return first; }
+        T* end(void) const { return first + length; }
+
+        //whether the elements still match the checksum they were saved with
+        //(copy_on_write changes made since opening count as damage)
+        bool verify(void) const { return checksum(first, length * sizeof(T)) == expected_checksum; }
+
+        //an owning copy of the elements
+        template <typename A = allocator<element> >
+        vector<element, A> to_vector(const A& a = A()) const { return vector<element, A>(first, first + length, a); }
+    };
+
+    //maps a file written by save() read-only
+    template <typename T>
+    mapped_vector<const T> load(const std::string& path) { return mapped_vector<const T>(path); }
+
+    //maps a file written by save() for private, copy-on-write changes
+    template <typename T>
+    mapped_vector<T> load_copy_on_write(const std::string& path) { return mapped_vector<T>(path); }
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#undef EPL_HAS_MMAP_FILES
+
+#endif
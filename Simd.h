@@ -0,0 +1,447 @@
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+//Vectorized scans over epl::vector<int32_t/int64_t/float/double> and plain
+//arrays: sum, min, max, minmax, find, count, dot, add and multiply.
+//
+//Every kernel is written once with the compiler's vector extension and
+//compiled for SSE2, AVX2 and AVX-512 plus a plain scalar fallback; the best
+//one the CPU supports is picked at run time. All of them walk the data in
+//64-byte blocks with one accumulator lane per element of a block, so every
+//level adds the same values in the same order: floating point sums and dot
+//products come out bit-identical on every level, though they can differ in
+//the last bits from a left-to-right sum. (-ffast-math lets the compiler
+//reorder them and voids this.)
+//Integer arithmetic is done in the unsigned type of the same width, so
+//sums, dot products and element-wise results wrap modulo 2^bits where T
+//itself would overflow. min and max skip NaNs, and are NaN only when
+//every element is one.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EPL_SIMD_X86 1
+#else
+#define EPL_SIMD_X86 0
+#endif
+
+namespace epl{
+namespace simd{
+
+    enum level { SCALAR, SSE2, AVX2, AVX512 };
+
+    inline const char* level_name(level l){
+        switch(l){
+            case SSE2:   return "sse2";
+            case AVX2:   return "avx2";
+            case AVX512: return "avx512";
+            default:     return "scalar";
+        }
+    }
+
+    //the widest level this CPU runs
+    inline level detected(void){
+#if EPL_SIMD_X86
+        static const level l = __builtin_cpu_supports("avx512f") ? AVX512
+                             : __builtin_cpu_supports("avx2") ? AVX2
+                             : __builtin_cpu_supports("sse2") ? SSE2 : SCALAR;
+        return l;
+#else
+        return SCALAR;
+#endif
+    }
+
+namespace detail{
+
+    #define EPL_SIMD_INLINE inline __attribute__((always_inline))
+
+    //A product must not be fused into the sum it feeds: an FMA rounds once
+    //where a multiply and an add round twice, and only some targets have
+    //one. GCC fuses per function, so the instances below turn it off;
+    //clang fuses per expression, so the bodies do.
+#if defined(__clang__)
+    #define EPL_SIMD_UNFUSED _Pragma("STDC FP_CONTRACT OFF")
+    #define EPL_SIMD_UNFUSED_ATTR
+#else
+    #define EPL_SIMD_UNFUSED
+    #define EPL_SIMD_UNFUSED_ATTR optimize("fp-contract=off")
+#endif
+
+    template <typename T> struct mask_of;
+    template <> struct mask_of<int32_t> { typedef int32_t type; };
+    template <> struct mask_of<float> { typedef int32_t type; };
+    template <> struct mask_of<int64_t> { typedef int64_t type; };
+    template <> struct mask_of<double> { typedef int64_t type; };
+
+    //the type arithmetic on T is done in: unsigned for integers, so that
+    //overflow wraps instead of being undefined
+    template <typename T> struct arith_of { typedef T type; };
+    template <> struct arith_of<int32_t> { typedef uint32_t type; };
+    template <> struct arith_of<int64_t> { typedef uint64_t type; };
+
+    //Kernels walk the data in 64-byte blocks, each held in `unroll`
+    //registers of W bytes. Lane k of a block always lands in the same
+    //accumulator lane whatever W is, which is what keeps results identical
+    //across targets. Helpers take vectors by reference: a vector passed or
+    //returned by value would change the ABI between targets.
+    template <typename T, uint64_t W>
+    struct lanes{
+        static const uint64_t width = W / sizeof(T);
+        static const uint64_t unroll = 64 / W;
+        static const uint64_t count = 64 / sizeof(T);
+        typedef T vec __attribute__((vector_size(W)));
+        typedef typename arith_of<T>::type arith;
+        typedef arith avec __attribute__((vector_size(W)));
+        typedef typename mask_of<T>::type mask_elem;
+        typedef mask_elem mask __attribute__((vector_size(W)));
+
+        template <typename V>
+        static EPL_SIMD_INLINE void load(V& v, const T* p) { std::memcpy(&v, p, sizeof(v)); }
+        template <typename V>
+        static EPL_SIMD_INLINE void store(T* p, const V& v) { std::memcpy(p, &v, sizeof(v)); }
+
+        template <typename V>
+        static EPL_SIMD_INLINE auto lane(const V& v, uint64_t j) { return v[j]; }
+
+        template <typename V, typename X>
+        static EPL_SIMD_INLINE void splat(V& v, X x){
+            for(uint64_t j = 0; j < width; j++) { v[j] = x; }
+        }
+
+        static EPL_SIMD_INLINE bool any(const mask& m){
+            mask_elem acc = 0;
+            for(uint64_t j = 0; j < width; j++) { acc |= m[j]; }
+            return acc != 0;
+        }
+    };
+
+    //the scalar fallback: one element per "register"
+    template <typename T>
+    struct lanes<T, 0>{
+        static const uint64_t width = 1;
+        static const uint64_t unroll = 64 / sizeof(T);
+        static const uint64_t count = 64 / sizeof(T);
+        typedef T vec;
+        typedef typename arith_of<T>::type arith;
+        typedef arith avec;
+        typedef typename mask_of<T>::type mask_elem;
+        typedef mask_elem mask;
+
+        template <typename V>
+        static EPL_SIMD_INLINE void load(V& v, const T* p) { v = V(*p); }
+        template <typename V>
+        static EPL_SIMD_INLINE void store(T* p, const V& v) { *p = T(v); }
+
+        template <typename V>
+        static EPL_SIMD_INLINE V lane(const V& v, uint64_t) { return v; }
+
+        template <typename V, typename X>
+        static EPL_SIMD_INLINE void splat(V& v, X x) { v = x; }
+
+        static EPL_SIMD_INLINE bool any(const mask& m) { return m != 0; }
+    };
+
+    /*********************kernel bodies*************************************/
+    //the same bodies are inlined into every target below; arithmetic goes
+    //through avec and arith, loaded from and stored to T bit for bit
+
+    template <typename T, uint64_t W>
+    EPL_SIMD_INLINE T sum_body(const T* p, uint64_t n){
+        typedef lanes<T, W> L;
+        typedef typename L::arith U;
+        typename L::avec acc[L::unroll], x;
+        for(uint64_t u = 0; u < L::unroll; u++) { L::splat(acc[u], 0); }
+        uint64_t i = 0;
+        for(; i + L::count <= n; i += L::count){
+            for(uint64_t u = 0; u < L::unroll; u++) { L::load(x, p + i + u * L::width); acc[u] += x; }
+        }
+        U total = 0;
+        for(uint64_t u = 0; u < L::unroll; u++){
+            for(uint64_t j = 0; j < L::width; j++) { total += L::lane(acc[u], j); }
+        }
+        for(; i < n; i++) { total += U(p[i]); }
+        return T(total);
+    }
+
+    template <typename T, uint64_t W>
+    EPL_SIMD_INLINE T dot_body(const T* a, const T* b, uint64_t n){
+        EPL_SIMD_UNFUSED
+        typedef lanes<T, W> L;
+        typedef typename L::arith U;
+        typename L::avec acc[L::unroll], x, y;
+        for(uint64_t u = 0; u < L::unroll; u++) { L::splat(acc[u], 0); }
+        uint64_t i = 0;
+        for(; i + L::count <= n; i += L::count){
+            for(uint64_t u = 0; u < L::unroll; u++){
+                L::load(x, a + i + u * L::width);
+                L::load(y, b + i + u * L::width);
+                acc[u] += x * y;
+            }
+        }
+        U total = 0;
+        for(uint64_t u = 0; u < L::unroll; u++){
+            for(uint64_t j = 0; j < L::width; j++) { total += L::lane(acc[u], j); }
+        }
+        for(; i < n; i++) { total += U(a[i]) * U(b[i]); }
+        return T(total);
+    }
+
+    //n must be at least 1. Every lane starts from the first element that
+    //is not a NaN; a NaN compares false, so it never replaces a bound.
+    template <typename T, uint64_t W>
+    EPL_SIMD_INLINE std::pair<T, T> minmax_body(const T* p, uint64_t n){
+        typedef lanes<T, W> L;
+        uint64_t i = 0;
+        while(i < n && p[i] != p[i]) { i++; }
+        if(i == n) { return std::make_pair(p[0], p[0]); }
+        T lo = p[i], hi = p[i];
+        if(n - i >= L::count){
+            typename L::vec vlo[L::unroll], vhi[L::unroll], x;
+            for(uint64_t u = 0; u < L::unroll; u++) { L::splat(vlo[u], lo); vhi[u] = vlo[u]; }
+            for(; i + L::count <= n; i += L::count){
+                for(uint64_t u = 0; u < L::unroll; u++){
+                    L::load(x, p + i + u * L::width);
+                    vlo[u] = (x < vlo[u]) ? x : vlo[u];
+                    vhi[u] = (x > vhi[u]) ? x : vhi[u];
+                }
+            }
+            for(uint64_t u = 0; u < L::unroll; u++){
+                for(uint64_t j = 0; j < L::width; j++){
+                    if(L::lane(vlo[u], j) < lo) { lo = L::lane(vlo[u], j); }
+                    if(L::lane(vhi[u], j) > hi) { hi = L::lane(vhi[u], j); }
+                }
+            }
+        }
+        for(; i < n; i++){
+            if(p[i] < lo) { lo = p[i]; }
+            if(p[i] > hi) { hi = p[i]; }
+        }
+        return std::make_pair(lo, hi);
+    }
+
+    template <typename T, uint64_t W>
+    EPL_SIMD_INLINE uint64_t find_body(const T* p, uint64_t n, T value){
+        typedef lanes<T, W> L;
+        typename L::vec needle, x;
+        typename L::mask hit;
+        L::splat(needle, value);
+        uint64_t i = 0;
+        for(; i + L::count <= n; i += L::count){
+            L::load(x, p + i);
+            hit = (x == needle);
+            for(uint64_t u = 1; u < L::unroll; u++) { L::load(x, p + i + u * L::width); hit |= (x == needle); }
+            if(L::any(hit)) { break; }
+        }
+        for(; i < n; i++){
+            if(p[i] == value) { return i; }
+        }
+        return n;
+    }
+
+    template <typename T, uint64_t W>
+    EPL_SIMD_INLINE uint64_t count_body(const T* p, uint64_t n, T value){
+        typedef lanes<T, W> L;
+        typename L::vec needle, x;
+        typename L::mask acc[L::unroll];
+        L::splat(needle, value);
+        for(uint64_t u = 0; u < L::unroll; u++) { L::splat(acc[u], 0); }
+        uint64_t i = 0;
+        for(; i + L::count <= n; i += L::count){
+            //a true comparison is -1 in a vector and 1 in a scalar
+            for(uint64_t u = 0; u < L::unroll; u++) { L::load(x, p + i + u * L::width); acc[u] += (x == needle) & 1; }
+        }
+        uint64_t total = 0;
+        for(uint64_t u = 0; u < L::unroll; u++){
+            for(uint64_t j = 0; j < L::width; j++) { total += (uint64_t) L::lane(acc[u], j); }
+        }
+        for(; i < n; i++) { total += (p[i] == value); }
+        return total;
+    }
+
+    template <typename T, uint64_t W>
+    EPL_SIMD_INLINE void add_body(const T* a, const T* b, T* out, uint64_t n){
+        typedef lanes<T, W> L;
+        typedef typename L::arith U;
+        typename L::avec x, y;
+        uint64_t i = 0;
+        for(; i + L::width <= n; i += L::width) { L::load(x, a + i); L::load(y, b + i); x += y; L::store(out + i, x); }
+        for(; i < n; i++) { out[i] = T(U(a[i]) + U(b[i])); }
+    }
+
+    template <typename T, uint64_t W>
+    EPL_SIMD_INLINE void multiply_body(const T* a, const T* b, T* out, uint64_t n){
+        typedef lanes<T, W> L;
+        typedef typename L::arith U;
+        typename L::avec x, y;
+        uint64_t i = 0;
+        for(; i + L::width <= n; i += L::width) { L::load(x, a + i); L::load(y, b + i); x *= y; L::store(out + i, x); }
+        for(; i < n; i++) { out[i] = T(U(a[i]) * U(b[i])); }
+    }
+
+    /*********************one instance per target***************************/
+    template <typename T>
+    struct kernels{
+        T (*sum)(const T*, uint64_t);
+        T (*dot)(const T*, const T*, uint64_t);
+        std::pair<T, T> (*minmax)(const T*, uint64_t);
+        uint64_t (*find)(const T*, uint64_t, T);
+        uint64_t (*count)(const T*, uint64_t, T);
+        void (*add)(const T*, const T*, T*, uint64_t);
+        void (*multiply)(const T*, const T*, T*, uint64_t);
+    };
+
+    #define EPL_SIMD_INSTANCE(NAME, W, ATTR)                                                           \
+    template <typename T>                                                                              \
+    struct NAME{                                                                                       \
+        ATTR static T sum(const T* p, uint64_t n) { return sum_body<T, W>(p, n); }                     \
+        ATTR static T dot(const T* a, const T* b, uint64_t n) { return dot_body<T, W>(a, b, n); }      \
+        ATTR static std::pair<T, T> minmax(const T* p, uint64_t n) { return minmax_body<T, W>(p, n); } \
+        ATTR static uint64_t find(const T* p, uint64_t n, T v) { return find_body<T, W>(p, n, v); }    \
+        ATTR static uint64_t count(const T* p, uint64_t n, T v) { return count_body<T, W>(p, n, v); }  \
+        ATTR static void add(const T* a, const T* b, T* o, uint64_t n) { add_body<T, W>(a, b, o, n); } \
+        ATTR static void multiply(const T* a, const T* b, T* o, uint64_t n) { multiply_body<T, W>(a, b, o, n); } \
+        static kernels<T> table(void){                                                                 \
+            kernels<T> k = { &sum, &dot, &minmax, &find, &count, &add, &multiply };                    \
+            return k;                                                                                  \
+        }                                                                                              \
+    };
+
+    EPL_SIMD_INSTANCE(scalar_kernels, 0, __attribute__((EPL_SIMD_UNFUSED_ATTR)))
+#if EPL_SIMD_X86
+    EPL_SIMD_INSTANCE(sse2_kernels, 16, __attribute__((target("sse2"), EPL_SIMD_UNFUSED_ATTR)))
+    EPL_SIMD_INSTANCE(avx2_kernels, 32, __attribute__((target("avx2"), EPL_SIMD_UNFUSED_ATTR)))
+    EPL_SIMD_INSTANCE(avx512_kernels, 64, __attribute__((target("avx512f"), EPL_SIMD_UNFUSED_ATTR)))
+#endif
+
+    #undef EPL_SIMD_INSTANCE
+    #undef EPL_SIMD_UNFUSED_ATTR
+    #undef EPL_SIMD_UNFUSED
+    #undef EPL_SIMD_INLINE
+
+    template <typename T>
+    kernels<T> kernels_for(level l){
+        static_assert(std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value
+                      || std::is_same<T, float>::value || std::is_same<T, double>::value,
+                      "simd kernels cover int32_t, int64_t, float and double");
+        if(l > detected()) { l = detected(); }
+#if EPL_SIMD_X86
+        switch(l){
+            case AVX512: return avx512_kernels<T>::table();
+            case AVX2:   return avx2_kernels<T>::table();
+            case SSE2:   return sse2_kernels<T>::table();
+            default:     break;
+        }
+#endif
+        return scalar_kernels<T>::table();
+    }
+
+    template <typename T>
+    const kernels<T>& best(void){
+        static const kernels<T> k = kernels_for<T>(detected());
+        return k;
+    }
+
+} //namespace detail
+
+    /*********************array interface**********************************/
+    //each call runs on the detected level; pass a level to force a lower one
+
+    template <typename T>
+    T sum(const T* p, uint64_t n) { return detail::best<T>().sum(p, n); }
+    template <typename T>
+    T sum(const T* p, uint64_t n, level l) { return detail::kernels_for<T>(l).sum(p, n); }
+
+    template <typename T>
+    T dot(const T* a, const T* b, uint64_t n) { return detail::best<T>().dot(a, b, n); }
+    template <typename T>
+    T dot(const T* a, const T* b, uint64_t n, level l) { return detail::kernels_for<T>(l).dot(a, b, n); }
+
+    template <typename T>
+    std::pair<T, T> minmax(const T* p, uint64_t n){
+        if(n == 0) { throw std::out_of_range{"minmax of an empty range"}; }
+        return detail::best<T>().minmax(p, n);
+    }
+    template <typename T>
+    std::pair<T, T> minmax(const T* p, uint64_t n, level l){
+        if(n == 0) { throw std::out_of_range{"minmax of an empty range"}; }
+        return detail::kernels_for<T>(l).minmax(p, n);
+    }
+
+    template <typename T>
+    T min(const T* p, uint64_t n) { return minmax(p, n).first; }
+    template <typename T>
+    T max(const T* p, uint64_t n) { return minmax(p, n).second; }
+
+    //index of the first element equal to value, or n
+    template <typename T>
+    uint64_t find(const T* p, uint64_t n, T value) { return detail::best<T>().find(p, n, value); }
+    template <typename T>
+    uint64_t find(const T* p, uint64_t n, T value, level l) { return detail::kernels_for<T>(l).find(p, n, value); }
+
+    template <typename T>
+    uint64_t count(const T* p, uint64_t n, T value) { return detail::best<T>().count(p, n, value); }
+    template <typename T>
+    uint64_t count(const T* p, uint64_t n, T value, level l) { return detail::kernels_for<T>(l).count(p, n, value); }
+
+    //out[k] = a[k] + b[k]; out may alias a or b exactly
+    template <typename T>
+    void add(const T* a, const T* b, T* out, uint64_t n) { detail::best<T>().add(a, b, out, n); }
+    template <typename T>
+    void add(const T* a, const T* b, T* out, uint64_t n, level l) { detail::kernels_for<T>(l).add(a, b, out, n); }
+
+    template <typename T>
+    void multiply(const T* a, const T* b, T* out, uint64_t n) { detail::best<T>().multiply(a, b, out, n); }
+    template <typename T>
+    void multiply(const T* a, const T* b, T* out, uint64_t n, level l) { detail::kernels_for<T>(l).multiply(a, b, out, n); }
+
+
+    /*********************epl::vector interface*****************************/
+    template <typename T, typename A, typename G>
+    T sum(const vector<T, A, G>& v) { return sum(v.data(), v.size()); }
+
+    template <typename T, typename A, typename G>
+    std::pair<T, T> minmax(const vector<T, A, G>& v) { return minmax(v.data(), v.size()); }
+
+    template <typename T, typename A, typename G>
+    T min(const vector<T, A, G>& v) { return minmax(v.data(), v.size()).first; }
+
+    template <typename T, typename A, typename G>
+    T max(const vector<T, A, G>& v) { return minmax(v.data(), v.size()).second; }
+
+    template <typename T, typename A, typename G>
+    uint64_t find(const vector<T, A, G>& v, T value) { return find(v.data(), v.size(), value); }
+
+    template <typename T, typename A, typename G>
+    uint64_t count(const vector<T, A, G>& v, T value) { return count(v.data(), v.size(), value); }
+
+    template <typename T, typename A, typename G, typename B, typename H>
+    T dot(const vector<T, A, G>& a, const vector<T, B, H>& b){
+        if(a.size() != b.size()) { throw std::out_of_range{"dot of vectors of different sizes"}; }
+        return dot(a.data(), b.data(), a.size());
+    }
+
+    //out is resized to the common size
+    template <typename T, typename A, typename G, typename B, typename H, typename C, typename I>
+    void add(const vector<T, A, G>& a, const vector<T, B, H>& b, vector<T, C, I>& out){
+        if(a.size() != b.size()) { throw std::out_of_range{"add of vectors of different sizes"}; }
+        out.resize(a.size());
+        add(a.data(), b.data(), out.data(), a.size());
+    }
+
+    template <typename T, typename A, typename G, typename B, typename H, typename C, typename I>
+    void multiply(const vector<T, A, G>& a, const vector<T, B, H>& b, vector<T, C, I>& out){
+        if(a.size() != b.size()) { throw std::out_of_range{"multiply of vectors of different sizes"}; }
+        out.resize(a.size());
+        multiply(a.data(), b.data(), out.data(), a.size());
+    }
+
+} //namespace simd
+} //namespace epl
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef _SMALL_VECTOR_H_
+#define _SMALL_VECTOR_H_
+
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //An epl::vector that keeps up to N elements inside the object itself and
+    //only goes to the heap past that. It is an epl::vector, so push/pop at
+    //either end, the iterators and every other member behave the same; a
+    //small_vector can be passed wherever a vector<T, Alloc, Growth>& is
+    //expected.
+    template <typename T, uint64_t N, typename Alloc = allocator<T>, typename Growth = double_growth>
+    class small_vector : public vector<T, Alloc, Growth>{
+    private:
+        static_assert(N > 0, "small_vector needs an inline capacity");
+
+        typedef vector<T, Alloc, Growth> base;
+        typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type buffer;
+
+        T* inline_buffer(void) { return reinterpret_cast<T*>(&buffer); }
+
+    public:
+        small_vector(void) : base(inline_buffer(), N, Alloc()) {}
+
+        explicit small_vector(const Alloc& a) : base(inline_buffer(), N, a) {}
+
+        small_vector(std::initializer_list<T> i1, const Alloc& a = Alloc())
+            : base(inline_buffer(), N, a) {
+            this->append(i1.begin(), i1.end());
+        }
+
+        template<typename IT>
+        small_vector(IT b, IT e, const Alloc& a = Alloc()) : base(inline_buffer(), N, a) {
+            this->append(b, e);
+        }
+
+        small_vector(const small_vector& that) : base(inline_buffer(), N, that.get_allocator()) {
+            base::operator=(that);
+        }
+
+        small_vector(const base& that) : base(inline_buffer(), N, that.get_allocator()) {
+            base::operator=(that);
+        }
+
+        //Moving between small_vectors of the same N never allocates: inline
+        //elements fit in the inline buffer and a heap block is handed over.
+        //So it can throw only if moving a T can.
+        small_vector(small_vector&& that) noexcept(std::is_nothrow_move_constructible<T>::value) : base(inline_buffer(), N, that.get_allocator()) {
+            this->move_from(std::move(that));
+        }
+
+        //that may itself be a small_vector with more elements inline than N
+        small_vector(base&& that) : base(inline_buffer(), N, that.get_allocator()) {
+            this->move_from(std::move(that));
+        }
+
+        small_vector& operator=(const small_vector& that){
+            base::operator=(that);
+            return *this;
+        }
+
+        small_vector& operator=(small_vector&& that) noexcept(std::is_nothrow_move_constructible<T>::value){
+            this->move_from(std::move(that));
+            return *this;
+        }
+
+        small_vector& operator=(base&& that){
+            this->move_from(std::move(that));
+            return *this;
+        }
+
+        void swap(small_vector& that) noexcept(std::is_nothrow_move_constructible<T>::value){
+            if(this == &that) { return; }
+            small_vector tmp(std::move(that));
+            that = std::move(*this);
+            *this = std::move(tmp);
+        }
+
+        void swap(base& that){
+            base tmp(std::move(that));
+            that = std::move(*this);
+            *this = std::move(tmp);
+        }
+
+        //the elements go before the buffer they live in
+        ~small_vector(void){
+            EPL_IF_STATS(this->retire();)
+            this->clear();
+        }
+
+        bool is_inline(void) const { return this->data_in_inline_storage(); }
+
+        static constexpr uint64_t inline_size(void) { return N; }
+    };
+
+    template <typename T, uint64_t N, typename A, typename G>
+    void swap(small_vector<T, N, A, G>& a, small_vector<T, N, A, G>& b) noexcept(std::is_nothrow_move_constructible<T>::value) { a.swap(b); }
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef _SOA_VECTOR_H_
+#define _SOA_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //A contiguous run of one column: data() and size() go straight into
+    //the epl::simd kernels or any loop that wants a plain array.
+    template <typename T>
+    class column_span{
+    private:
+        T* first;
+        uint64_t length;
+
+    public:
+        typedef T value_type;
+
+        column_span(T* first, uint64_t length) { this->first = first; this->length = length; }
+
+        T* data(void) const { return first; }
+        uint64_t size(void) const { return length; }
+        bool empty(void) const { return length == 0; }
+
+        T& operator[](uint64_t k) const{
+            if(k >= length) { throw std::out_of_range{"subscript out of range"}; }
+            return first[k];
+        }
+
+        T* begin(void) const { return first; }
+        T* end(void) const { return first + length; }
+    };
+
+    //A sequence of records stored column by column: soa_vector<int, float>
+    //keeps an epl::vector<int> and an epl::vector<float> of equal length, so
+    //a pass over one field reads only that field's memory. Every column
+    //sees the same pushes and pops, so they all grow at both ends the same
+    //way a single epl::vector would.
+    //
+    //Rows are read and written through a tuple of references (reference),
+    //columns through column<I>(). Pushes are all-or-nothing: if building
+    //one field throws, the fields already added are removed again.
+    template <typename... Fields>
+    class soa_vector{
+    public:
+        typedef std::tuple<Fields...> value_type;
+        typedef std::tuple<Fields&...> reference;
+        typedef std::tuple<const Fields&...> const_reference;
+
+        template <std::size_t I>
+        using field_type = typename std::tuple_element<I, value_type>::type;
+
+    private:
+        static_assert(sizeof...(Fields) > 0, "soa_vector needs at least one field");
+
+        typedef std::tuple<vector<Fields>...> column_tuple;
+        typedef std::index_sequence_for<Fields...> indexes;
+
+        column_tuple columns;
+        uint64_t front_version;     //bumped when indexes shift (front push/pop)
+
+        template <typename F, std::size_t... I>
+        void each_column(F f, std::index_sequence<I...>){
+            int expand[] = { 0, (f(std::get<I>(columns)), 0)... };
+            (void) expand;
+        }
+
+        template <typename F>
+        void each_column(F f) { each_column(f, indexes()); }
+
+        template <std::size_t... I>
+        reference row(uint64_t k, std::index_sequence<I...>) { return reference(std::get<I>(columns)[k]...); }
+
+        template <std::size_t... I>
+        const_reference row(uint64_t k, std::index_sequence<I...>) const { return const_reference(std::get<I>(columns)[k]...); }
+
+        template <std::size_t... I, typename... Args>
+        void emplace_all_back(std::index_sequence<I...>, Args&&... args){
+            int expand[] = { 0, (std::get<I>(columns).emplace_back(std::forward<Args>(args)), 0)... };
+            (void) expand;
+        }
+
+        template <std::size_t... I, typename... Args>
+        void emplace_all_front(std::index_sequence<I...>, Args&&... args){
+            int expand[] = { 0, (std::get<I>(columns).emplace_front(std::forward<Args>(args)), 0)... };
+            (void) expand;
+        }
+
+        //after a failed push, trims the columns that already took their field
+        void restore_back(uint64_t n) { each_column([n](auto& c) { while(c.size() > n) { c.pop_back(); } }); }
+        void restore_front(uint64_t n) { each_column([n](auto& c) { while(c.size() > n) { c.pop_front(); } }); }
+
+    public:
+        soa_vector(void) { front_version = 0; }
+
+        explicit soa_vector(uint64_t n) : columns(vector<Fields>(n)...) { front_version = 0; }
+
+        soa_vector(std::initializer_list<value_type> i1){
+            front_version = 0;
+            reserve(i1.size());
+            for(auto iter = i1.begin(); iter != i1.end(); ++iter) { push_back(*iter); }
+        }
+
+        soa_vector(const soa_vector& that) : columns(that.columns) { front_version = 0; }
+
+        soa_vector(soa_vector&& that) : columns(std::move(that.columns)) { front_version = 0; }
+
+        soa_vector& operator=(const soa_vector& that){
+            if(this != &that) { columns = that.columns; }
+            front_version++;
+            return *this;
+        }
+
+        soa_vector& operator=(soa_vector&& that){
+            if(this != &that) { columns = std::move(that.columns); }
+            front_version++;
+            return *this;
+        }
+
+        uint64_t size(void) const { return std::get<0>(columns).size(); }
+        bool empty(void) const { return size() == 0; }
+        uint64_t capacity(void) const { return std::get<0>(columns).capacity(); }
+
+        /*********************rows****************************************/
+        reference operator[](uint64_t k){
+            if(k >= size()) { throw std::out_of_range{"subscript out of range"}; }
+            return row(k, indexes());
+        }
+
+        const_reference operator[](uint64_t k) const{
+            if(k >= size()) { throw std::out_of_range{"subscript out of range"}; }
+            return row(k, indexes());
+        }
+
+        reference front(void) { return (*this)[0]; }
+        reference back(void) { return (*this)[size() - 1]; }
+
+        //one field of row k
+        template <std::size_t I>
+        field_type<I>& get(uint64_t k) { return std::get<I>(columns)[k]; }
+
+        template <std::size_t I>
+        const field_type<I>& get(uint64_t k) const { return std::get<I>(columns)[k]; }
+
+        /*********************columns*************************************/
+        template <std::size_t I>
+        column_span<field_type<I> > column(void){
+            vector<field_type<I> >& c = std::get<I>(columns);
+            return column_span<field_type<I> >(c.data(), c.size());
+        }
+
+        template <std::size_t I>
+        column_span<const field_type<I> > column(void) const{
+            const vector<field_type<I> >& c = std::get<I>(columns);
+            return column_span<const field_type<I> >(c.data(), c.size());
+        }
+
+        /*********************push and pop********************************/
+        //one argument per field, each used to construct that field
+        template <typename... Args>
+        void emplace_back(Args&&... args){
+            static_assert(sizeof...(Args) == sizeof...(Fields), "one argument per field");
+            uint64_t n = size();
+            try { emplace_all_back(indexes(), std::forward<Args>(args)...); }
+            catch(...) { restore_back(n); throw; }
+        }
+
+        template <typename... Args>
+        void emplace_front(Args&&... args){
+            static_assert(sizeof...(Args) == sizeof...(Fields), "one argument per field");
+            uint64_t n = size();
+            try { emplace_all_front(indexes(), std::forward<Args>(args)...); }
+            catch(...) { restore_front(n); throw; }
+            front_version++;
+        }
+
+        void push_back(const Fields&... fields) { emplace_back(fields...); }
+        void push_front(const Fields&... fields) { emplace_front(fields...); }
+
+        //a whole row, e.g. one read from another soa_vector
+        template <typename... Ts>
+        void push_back(const std::tuple<Ts...>& r) { push_row_back(r, indexes()); }
+
+        template <typename... Ts>
+        void push_front(const std::tuple<Ts...>& r) { push_row_front(r, indexes()); }
+
+        void pop_back(void){
+            if(empty()) { throw std::out_of_range{"no data to be poped"}; }
+            each_column([](auto& c) { c.pop_back(); });
+        }
+
+        void pop_front(void){
+            if(empty()) { throw std::out_of_range{"no data to be poped"}; }
+            each_column([](auto& c) { c.pop_front(); });
+            front_version++;
+        }
+
+        /*********************capacity************************************/
+        void reserve(uint64_t n) { each_column([n](auto& c) { c.reserve(n); }); }
+        void reserve_front(uint64_t n) { each_column([n](auto& c) { c.reserve_front(n); }); }
+        void shrink_to_fit(void) { each_column([](auto& c) { c.shrink_to_fit(); }); }
+
+        void resize(uint64_t n){
+            uint64_t old = size();
+            try { each_column([n](auto& c) { c.resize(n); }); }
+            catch(...) { restore_back(old); throw; }
+        }
+
+        void clear(void){
+            each_column([](auto& c) { c.clear(); });
+            front_version++;
+        }
+
+    private:
+        template <typename R, std::size_t... I>
+        void push_row_back(const R& r, std::index_sequence<I...>) { emplace_back(std::get<I>(r)...); }
+
+        template <typename R, std::size_t... I>
+        void push_row_front(const R& r, std::index_sequence<I...>) { emplace_front(std::get<I>(r)...); }
+
+    public:
+        /**********************iterator class*********************************/
+        //Walks row indexes; dereferencing yields a reference tuple, so
+        //`for(auto r : v) std::get<0>(r) += 1;` writes through. Pushing at
+        //the back never invalidates it; front pushes and pops shift every
+        //index, which a checked iterator reports as a MILD invalid_iterator.
+        template <bool Const>
+        class basic_iterator{
+        private:
+            typedef typename std::conditional<Const, const soa_vector, soa_vector>::type container;
+            container* parent;
+            int64_t index;
+#if EPL_CHECKED_ITERATORS
+            uint64_t iterator_version;
+#endif
+
+            template <bool> friend class basic_iterator;
+
+        public:
+            typedef typename soa_vector::value_type value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<Const, typename soa_vector::const_reference, typename soa_vector::reference>::type reference;
+            typedef void pointer;
+
+            basic_iterator(void) { parent = nullptr; index = 0; set_version(); }
+
+            basic_iterator(container* parent, int64_t index){
+                this->parent = parent;
+                this->index = index;
+                set_version();
+            }
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            basic_iterator(const basic_iterator<C>& it){
+                parent = it.parent;
+                index = it.index;
+#if EPL_CHECKED_ITERATORS
+                iterator_version = it.iterator_version;
+#endif
+            }
+
+            reference operator*(void) const { check_exception(); return parent->row(index, indexes()); }
+            reference operator[](int64_t k) const { check_exception(); return parent->row(index + k, indexes()); }
+
+            basic_iterator& operator++() { index++; return *this; }
+            basic_iterator operator++(int) { basic_iterator tmp{*this}; index++; return tmp; }
+            basic_iterator& operator--() { index--; return *this; }
+            basic_iterator operator--(int) { basic_iterator tmp{*this}; index--; return tmp; }
+
+            basic_iterator& operator+=(int64_t k) { index += k; return *this; }
+            basic_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            basic_iterator operator+(int64_t k) const { basic_iterator tmp{*this}; tmp.index += k; return tmp; }
+            basic_iterator operator-(int64_t k) const { basic_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            int64_t operator-(const basic_iterator& it) const { return index - it.index; }
+
+            bool operator==(const basic_iterator& it) const { check_exception(); return index == it.index; }
+            bool operator!=(const basic_iterator& it) const { return !(*this == it); }
+            bool operator<(const basic_iterator& it) const { return index < it.index; }
+            bool operator>(const basic_iterator& it) const { return index > it.index; }
+            bool operator<=(const basic_iterator& it) const { return index <= it.index; }
+            bool operator>=(const basic_iterator& it) const { return index >= it.index; }
+
+#if EPL_CHECKED_ITERATORS
+            void set_version(void) { iterator_version = parent ? parent->front_version : 0; }
+
+            void check_exception() const{
+                if(parent != nullptr && iterator_version != parent->front_version)
+                    throw epl::invalid_iterator{    epl::invalid_iterator::MILD  };
+            }
+#else
+            void set_version(void) {}
+            void check_exception() const {}
+#endif
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        iterator begin(void) { return iterator(this, 0); }
+        iterator end(void) { return iterator(this, size()); }
+        const_iterator begin(void) const { return const_iterator(this, 0); }
+        const_iterator end(void) const { return const_iterator(this, size()); }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
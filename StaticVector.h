@@ -0,0 +1,325 @@
+#ifndef _STATIC_VECTOR_H_
+#define _STATIC_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+namespace static_detail{
+
+    //The N slots and which of them hold elements. Trivial T gets a plain
+    //array that constexpr code can read and write; any other T gets raw
+    //storage, constructed and destroyed slot by slot.
+    template <typename T, uint64_t N, bool Trivial = std::is_trivial<T>::value>
+    struct storage{
+        T items[N];
+        uint64_t first;
+        uint64_t length;
+
+#if __cplusplus >= 202002L
+        constexpr storage(void) : first(0), length(0) {}    //C++20 constexpr allows items uninitialized
+#else
+        constexpr storage(void) : items(), first(0), length(0) {}
+#endif
+
+        constexpr T* slot(uint64_t k) { return items + k; }
+        constexpr const T* slot(uint64_t k) const { return items + k; }
+
+        template <typename... Args>
+        constexpr void make(uint64_t k, Args&&... args) { items[k] = T(std::forward<Args>(args)...); }
+
+        constexpr void unmake(uint64_t) {}
+    };
+
+    template <typename T, uint64_t N>
+    struct storage<T, N, false>{
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type items[N];
+        uint64_t first;
+        uint64_t length;
+
+        storage(void) : first(0), length(0) {}
+
+        storage(const storage& that) : first(0), length(0) { fill(that, std::false_type()); }
+
+        storage(storage&& that) noexcept(std::is_nothrow_move_constructible<T>::value) : first(0), length(0) {
+            fill(that, std::true_type());
+        }
+
+        storage& operator=(const storage& that){
+            if(this != &that){
+                destroy();
+                fill(that, std::false_type());
+            }
+            return *this;
+        }
+
+        storage& operator=(storage&& that) noexcept(std::is_nothrow_move_constructible<T>::value){
+            if(this != &that){
+                destroy();
+                fill(that, std::true_type());
+            }
+            return *this;
+        }
+
+        ~storage(void) { destroy(); }
+
+        void destroy(void){
+            for(uint64_t k = 0; k < length; k++) { unmake(first + k); }
+            length = 0;
+        }
+
+        static const T& pass(const T& x, std::false_type) { return x; }
+        static T&& pass(const T& x, std::true_type) { return std::move(const_cast<T&>(x)); }
+
+        //copies (Move false) or moves that's elements into the same slots of
+        //this empty storage; if one throws, those made so far are destroyed
+        template <typename Move>
+        void fill(const storage& that, Move move){
+            first = that.first;
+            try{
+                for(; length < that.length; length++) { make(first + length, pass(*that.slot(first + length), move)); }
+            }
+            catch(...) { destroy(); throw; }
+        }
+
+        T* slot(uint64_t k) { return reinterpret_cast<T*>(items + k); }
+        const T* slot(uint64_t k) const { return reinterpret_cast<const T*>(items + k); }
+
+        template <typename... Args>
+        void make(uint64_t k, Args&&... args) { new(items + k) T(std::forward<Args>(args)...); }
+
+        void unmake(uint64_t k) { slot(k) -> ~T(); }
+    };
+
+} //namespace static_detail
+
+    //A double-ended vector of at most N elements, stored inline: it never
+    //allocates. The elements are contiguous somewhere in the N slots; when
+    //one end runs out of slots while the other has some, the elements are
+    //moved to split the free slots evenly between the ends, the way
+    //epl::vector recenters. Pushing onto a full static_vector throws
+    //std::out_of_range instead of growing.
+    //
+    //For trivial T every member is constexpr, so under C++20 (and C++14,
+    //at the cost of zeroing the slots on construction) a table can be
+    //built by a constexpr function and kept in a constexpr variable.
+    //Recentering moves elements; a move that throws part way through
+    //leaves the elements in an unspecified state.
+    template <typename T, uint64_t N>
+    class static_vector{
+    private:
+        static_assert(N > 0, "a static_vector needs at least one slot");
+
+        static_detail::storage<T, N> store;
+        uint64_t front_version = 0;     //bumped when indexes shift (front push/pop)
+
+        //moves the elements so that they start at slot to
+        constexpr void shift(uint64_t to){
+            uint64_t from = store.first, n = store.length;
+            if(to > from){
+                for(uint64_t k = n; k-- != 0; ){
+                    store.make(to + k, std::move(*store.slot(from + k)));
+                    store.unmake(from + k);
+                }
+            }
+            else if(to < from){
+                for(uint64_t k = 0; k < n; k++){
+                    store.make(to + k, std::move(*store.slot(from + k)));
+                    store.unmake(from + k);
+                }
+            }
+            store.first = to;
+        }
+
+        constexpr void room_at_back(void){
+            if(store.length == N) { throw std::out_of_range{"static_vector is full"}; }
+            if(store.first + store.length == N) { shift((N - store.length) / 2); }
+        }
+
+        constexpr void room_at_front(void){
+            if(store.length == N) { throw std::out_of_range{"static_vector is full"}; }
+            if(store.first == 0){
+                uint64_t free = N - store.length;
+                shift(free - free / 2);
+            }
+        }
+
+    public:
+        typedef T value_type;
+
+        constexpr static_vector(void) {}
+
+        constexpr explicit static_vector(uint64_t n){
+            if(n > N) { throw std::out_of_range{"static_vector is full"}; }
+            for(uint64_t k = 0; k < n; k++) { emplace_back(); }
+        }
+
+        constexpr static_vector(std::initializer_list<T> i1){
+            if(i1.size() > N) { throw std::out_of_range{"static_vector is full"}; }
+            for(auto iter = i1.begin(); iter != i1.end(); ++iter) { push_back(*iter); }
+        }
+
+        template<typename IT>
+        constexpr static_vector(IT b, IT e){
+            for(; b != e; ++b) { emplace_back(*b); }
+        }
+
+        constexpr uint64_t size(void) const { return store.length; }
+        constexpr bool empty(void) const { return store.length == 0; }
+        constexpr bool full(void) const { return store.length == N; }
+        static constexpr uint64_t capacity(void) { return N; }
+
+        constexpr T* data(void) { return store.slot(store.first); }
+        constexpr const T* data(void) const { return store.slot(store.first); }
+
+        constexpr T& operator[](uint64_t k){
+            if(k >= store.length) { throw std::out_of_range{"subscript out of range"}; }
+            return *store.slot(store.first + k);
+        }
+
+        constexpr const T& operator[](uint64_t k) const{
+            if(k >= store.length) { throw std::out_of_range{"subscript out of range"}; }
+            return *store.slot(store.first + k);
+        }
+
+        constexpr void push_back(const T& that) { emplace_back(that); }
+        constexpr void push_back(T&& that) { emplace_back(std::move(that)); }
+        constexpr void push_front(const T& that) { emplace_front(that); }
+        constexpr void push_front(T&& that) { emplace_front(std::move(that)); }
+
+        template <typename... Args>
+        constexpr T& emplace_back(Args&&... args){
+            room_at_back();
+            store.make(store.first + store.length, std::forward<Args>(args)...);
+            store.length++;
+            return *store.slot(store.first + store.length - 1);
+        }
+
+        template <typename... Args>
+        constexpr T& emplace_front(Args&&... args){
+            room_at_front();
+            store.make(store.first - 1, std::forward<Args>(args)...);
+            store.first--;
+            store.length++;
+            front_version++;
+            return *store.slot(store.first);
+        }
+
+        constexpr void pop_back(void){
+            if(store.length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            store.length--;
+            store.unmake(store.first + store.length);
+        }
+
+        constexpr void pop_front(void){
+            if(store.length == 0) { throw std::out_of_range{"no data to be poped"}; }
+            store.unmake(store.first);
+            store.first++;
+            store.length--;
+            front_version++;
+        }
+
+        constexpr void clear(void){
+            for(uint64_t k = 0; k < store.length; k++) { store.unmake(store.first + k); }
+            store.first = 0;
+            store.length = 0;
+            front_version++;
+        }
+
+        /**********************iterator class*********************************/
+        //An index into the elements. Pushing at the back never invalidates
+        //it; pushing or popping at the front shifts every index, which a
+        //checked iterator reports as a MILD invalid_iterator.
+        template <bool Const>
+        class basic_iterator{
+        private:
+            typedef typename std::conditional<Const, const static_vector, static_vector>::type container;
+            container* parent;
+            int64_t index;
+#if EPL_CHECKED_ITERATORS
+            uint64_t iterator_version;
+#endif
+
+            friend class static_vector;
+            template <bool> friend class basic_iterator;
+
+        public:
+            typedef T value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<Const, const T*, T*>::type pointer;
+            typedef typename std::conditional<Const, const T&, T&>::type reference;
+
+#if EPL_CHECKED_ITERATORS
+            constexpr basic_iterator(void) : parent(nullptr), index(0), iterator_version(0) {}
+
+            constexpr basic_iterator(container* parent, int64_t index)
+                : parent(parent), index(index), iterator_version(parent->front_version) {}
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            constexpr basic_iterator(const basic_iterator<C>& it)
+                : parent(it.parent), index(it.index), iterator_version(it.iterator_version) {}
+#else
+            constexpr basic_iterator(void) : parent(nullptr), index(0) {}
+
+            constexpr basic_iterator(container* parent, int64_t index) : parent(parent), index(index) {}
+
+            template <bool C, typename = typename std::enable_if<Const && !C>::type>
+            constexpr basic_iterator(const basic_iterator<C>& it) : parent(it.parent), index(it.index) {}
+#endif
+
+            constexpr reference operator*(void) const { check_exception(); return (*parent)[index]; }
+            constexpr pointer operator->(void) const { check_exception(); return &(*parent)[index]; }
+            constexpr reference operator[](int64_t k) const { check_exception(); return (*parent)[index + k]; }
+
+            constexpr basic_iterator& operator++() { index++; return *this; }
+            constexpr basic_iterator operator++(int) { basic_iterator tmp{*this}; index++; return tmp; }
+            constexpr basic_iterator& operator--() { index--; return *this; }
+            constexpr basic_iterator operator--(int) { basic_iterator tmp{*this}; index--; return tmp; }
+
+            constexpr basic_iterator& operator+=(int64_t k) { index += k; return *this; }
+            constexpr basic_iterator& operator-=(int64_t k) { index -= k; return *this; }
+            constexpr basic_iterator operator+(int64_t k) const { basic_iterator tmp{*this}; tmp.index += k; return tmp; }
+            constexpr basic_iterator operator-(int64_t k) const { basic_iterator tmp{*this}; tmp.index -= k; return tmp; }
+            constexpr int64_t operator-(const basic_iterator& it) const { return index - it.index; }
+
+            constexpr bool operator==(const basic_iterator& it) const { check_exception(); return index == it.index; }
+            constexpr bool operator!=(const basic_iterator& it) const { return !(*this == it); }
+            constexpr bool operator<(const basic_iterator& it) const { return index < it.index; }
+            constexpr bool operator>(const basic_iterator& it) const { return index > it.index; }
+            constexpr bool operator<=(const basic_iterator& it) const { return index <= it.index; }
+            constexpr bool operator>=(const basic_iterator& it) const { return index >= it.index; }
+
+#if EPL_CHECKED_ITERATORS
+            constexpr void check_exception() const{
+                if(parent != nullptr && iterator_version != parent->front_version)
+                    throw epl::invalid_iterator{    epl::invalid_iterator::MILD  };
+            }
+#else
+            constexpr void check_exception() const {}
+#endif
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        constexpr iterator begin(void) { return iterator(this, 0); }
+        constexpr iterator end(void) { return iterator(this, store.length); }
+        constexpr const_iterator begin(void) const { return const_iterator(this, 0); }
+        constexpr const_iterator end(void) const { return const_iterator(this, store.length); }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "Vector.h"
+
+//Moving trivially copyable elements between file descriptors (files,
+//pipes, sockets) and epl::vector without a staging buffer: reads land in
+//the vector's back slack and become elements in place, writes gather
+//straight from the vectors' storage.
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //elements per read: about 1 MiB
+    template <typename T>
+    constexpr uint64_t stream_batch(void) { return sizeof(T) >= (uint64_t(1) << 20) ? 1 : (uint64_t(1) << 20) / sizeof(T); }
+
+    //Appends the elements read from fd to a vector, one batch per call. A
+    //read may stop in the middle of an element (a pipe delivers whatever
+    //is ready); the loose bytes are kept and completed by the next read.
+    template <typename T>
+    class fd_reader{
+    private:
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable elements can be streamed");
+
+        int fd;
+        uint64_t batch;
+        unsigned char carry[sizeof(T)];     //bytes of an element not fully read yet
+        uint64_t carried;
+        bool at_eof;
+
+    public:
+        explicit fd_reader(int fd, uint64_t batch = stream_batch<T>()){
+            this->fd = fd;
+            this->batch = (batch == 0) ? 1 : batch;
+            carried = 0;
+            at_eof = false;
+        }
+
+        //true once fd has reported end of file
+        bool eof(void) const { return at_eof; }
+
+        //Reads up to one batch into v and returns the number of elements
+        //appended: 0 at end of file, or when a non-blocking fd has nothing
+        //ready. Throws std::system_error on a read error and
+        //std::runtime_error if the stream ends inside an element.
+        template <typename A, typename G>
+        uint64_t read(vector<T, A, G>& v){
+            if(at_eof) { return 0; }
+            unsigned char* bytes = reinterpret_cast<unsigned char*>(v.back_buffer(batch));
+            std::memcpy(bytes, carry, carried);
+            ssize_t got;
+            do { got = ::read(fd, bytes + carried, batch * sizeof(T) - carried); } while(got < 0 && errno == EINTR);
+            if(got < 0){
+                if(errno == EAGAIN || errno == EWOULDBLOCK) { return 0; }
+                throw std::system_error(errno, std::generic_category(), "read");
+            }
+            if(got == 0){
+                at_eof = true;
+                if(carried != 0) { throw std::runtime_error{"stream ended inside an element"}; }
+                return 0;
+            }
+            uint64_t total = carried + got;
+            uint64_t n = total / sizeof(T);
+            carried = total % sizeof(T);
+            std::memcpy(carry, bytes + n * sizeof(T), carried);
+            v.commit_back(n);
+            return n;
+        }
+
+        //reads a blocking fd to its end; returns the elements appended
+        template <typename A, typename G>
+        uint64_t read_all(vector<T, A, G>& v){
+            uint64_t n = 0;
+            while(!at_eof) { n += read(v); }
+            return n;
+        }
+    };
+
+    namespace stream_detail{
+        template <typename T, typename A, typename G>
+        void gather(struct iovec* iov, const vector<T, A, G>& v){
+            iov->iov_base = const_cast<T*>(v.data());
+            iov->iov_len = v.size() * sizeof(T);
+        }
+
+        //writev until every byte of iov[0, n) is out
+        inline void write_iov(int fd, struct iovec* iov, int n){
+            while(n > 0){
+                ssize_t put = ::writev(fd, iov, n);
+                if(put < 0){
+                    if(errno == EINTR) { continue; }
+                    throw std::system_error(errno, std::generic_category(), "writev");
+                }
+                uint64_t left = put;
+                while(n > 0 && left >= iov->iov_len){
+                    left -= iov->iov_len;
+                    iov++;
+                    n--;
+                }
+                if(n > 0){
+                    iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+                    iov->iov_len -= left;
+                }
+            }
+        }
+    }
+
+    //Writes the elements of every vector, in order, with one writev per
+    //pass instead of one write per vector. Blocks until all of it is out.
+    template <typename T, typename... As, typename... Gs>
+    void write_all(int fd, const vector<T, As, Gs>&... vs){
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable elements can be streamed");
+        struct iovec iov[sizeof...(As)];
+        int k = 0;
+        int expand[] = { 0, (stream_detail::gather(iov + k++, vs), 0)... };
+        (void) expand;
+        stream_detail::write_iov(fd, iov, sizeof...(As));
+    }
+
+    //writes v to fd and empties it, keeping its storage for the next batch
+    template <typename T, typename A, typename G>
+    void drain(int fd, vector<T, A, G>& v){
+        write_all(fd, v);
+        v.clear();
+    }
+
+    //Double-buffered ingest: reads fd to its end on a second thread, in
+    //chunks of about batch elements, and calls f(vector<T>& chunk) on this
+    //thread for each one while the next is being read. Returns the number of
+    //elements read. If f throws, reading stops after the read in progress
+    //and the exception is rethrown here; so is a read error.
+    template <typename T, typename F>
+    uint64_t for_each_chunk(int fd, F f, uint64_t batch = stream_batch<T>()){
+        struct handoff{
+            std::mutex m;
+            std::condition_variable cv;
+            vector<T> chunk[2];
+            bool full[2] = { false, false };
+            bool done = false;
+            bool stop = false;
+            std::exception_ptr error;
+        } h;
+
+        std::thread reader([&h, fd, batch](){
+            try{
+                fd_reader<T> in(fd, batch);
+                for(int k = 0; ; k ^= 1){
+                    {
+                        std::unique_lock<std::mutex> lock(h.m);
+                        h.cv.wait(lock, [&h, k](){ return !h.full[k] || h.stop; });
+                        if(h.stop) { return; }
+                    }
+                    h.chunk[k].clear();
+                    while(h.chunk[k].size() < batch && !in.eof()) { in.read(h.chunk[k]); }
+                    std::lock_guard<std::mutex> lock(h.m);
+                    h.full[k] = true;
+                    h.done = in.eof();
+                    h.cv.notify_all();
+                    if(h.done) { return; }
+                }
+            }
+            catch(...){
+                std::lock_guard<std::mutex> lock(h.m);
+                h.error = std::current_exception();
+                h.done = true;
+                h.cv.notify_all();
+            }
+        });
+
+        uint64_t total = 0;
+        try{
+            for(int k = 0; ; k ^= 1){
+                {
+                    std::unique_lock<std::mutex> lock(h.m);
+                    h.cv.wait(lock, [&h, k](){ return h.full[k] || h.done; });
+                    if(h.error) { std::rethrow_exception(h.error); }
+                    if(!h.full[k]) { break; }
+                }
+                total += h.chunk[k].size();
+                if(h.chunk[k].size() != 0) { f(h.chunk[k]); }
+                std::lock_guard<std::mutex> lock(h.m);
+                h.full[k] = false;
+                h.cv.notify_all();
+            }
+        }
+        catch(...){
+            {
+                std::lock_guard<std::mutex> lock(h.m);
+                h.stop = true;
+                h.cv.notify_all();
+            }
+            reader.join();
+            throw;
+        }
+        reader.join();
+        return total;
+    }
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -1,10 +1,69 @@
 #ifndef _VECTOR_H_
 #define _VECTOR_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 
+#include "Allocator.h"
+#include "Growth.h"
+
+//Growth statistics (VectorStats.h): off unless this is 1, and free when off.
+#ifndef EPL_VECTOR_STATS
+#define EPL_VECTOR_STATS 0
+#endif
+
+#if EPL_VECTOR_STATS
+#include "VectorStats.h"
+#define EPL_IF_STATS(...) __VA_ARGS__
+#else
+#define EPL_IF_STATS(...)
+#endif
+
+//Branch hints and out-of-line cold paths, where the compiler has them
+#if defined(__GNUC__)
+#define EPL_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define EPL_COLD __attribute__((noinline, cold))
+#elif defined(_MSC_VER)
+#define EPL_UNLIKELY(x) (x)
+#define EPL_COLD __declspec(noinline)
+#else
+#define EPL_UNLIKELY(x) (x)
+#define EPL_COLD
+#endif
+
+//Iterators are checked against use after modification unless this is 0.
+//It defaults to on for debug builds and off when NDEBUG is defined, so a
+//release build iterates through what is effectively a raw pointer.
+#ifndef EPL_CHECKED_ITERATORS
+#ifdef NDEBUG
+#define EPL_CHECKED_ITERATORS 0
+#else
+#define EPL_CHECKED_ITERATORS 1
+#endif
+#endif
+
+//The two modes lay the iterators out differently, so the containers built
+//on them are declared in epl::checked or epl::unchecked, an inline
+//namespace chosen by the mode. Code still names them epl::vector, but
+//translation units built in different modes get distinct types, and
+//passing one between them fails to link instead of corrupting iterators.
+#if EPL_CHECKED_ITERATORS
+#define EPL_ITERATOR_NAMESPACE checked
+#else
+#define EPL_ITERATOR_NAMESPACE unchecked
+#endif
+
 //Utility gives std::rel_ops which will fill in relational
 //iterator operations so long as you provide the
 //operators discussed in class.  In any case, ensure that
@@ -32,8 +91,19 @@ namespace epl{
         }
     };
 
-    static int min_capacity = 8;
+    //A type is trivially relocatable when moving it to a new address and
+    //abandoning the old bytes is the same as memcpy. Growth relocates such
+    //types with one memcpy (or an in-place realloc) and runs no destructors.
+    //Specialize this for types that own resources but do not hold pointers
+    //into themselves (for example a handle class or std::unique_ptr).
     template <typename T>
+    struct is_trivially_relocatable
+        : std::integral_constant<bool, std::is_trivially_copyable<T>::value> {};
+
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    //Growth is the growth policy, see Growth.h
+    template <typename T, typename Alloc = allocator<T>, typename Growth = double_growth>
     class vector{
     private:
         T* dbegin;
@@ -45,103 +115,183 @@ namespace epl{
         uint64_t front_storage;
         uint64_t reallocate_times;
         uint64_t vector_version;
+        uint64_t front_mark;
+        uint64_t back_mark;
+        Alloc alloc;
+        //owners of the block when it is shared with snapshots, else nullptr;
+        //atomic because snapshot() installs it from const, concurrent callers
+        mutable std::atomic<std::atomic<uint64_t>*> shared{nullptr};
+#if EPL_VECTOR_STATS
+        vector_stats counters = vector_stats();
+        const char* stats_site = nullptr;
+        growth_end growing = growth_end::other;     //the end the growth under way is for
+        bool retired = false;
+#endif
+
+    protected:
+        //storage owned by a derived class (small_vector); never handed to alloc
+        T* inline_storage = nullptr;
+        uint64_t inline_capacity = 0;
+
+    private:
+
+        static const bool relocatable = is_trivially_relocatable<T>::value;
+
+        //a type derived from vector (small_vector), moved from as an rvalue
+        template <typename V>
+        using derived_rvalue = typename std::enable_if<std::is_base_of<vector, V>::value
+            && !std::is_same<vector, typename std::remove_cv<V>::type>::value && !std::is_const<V>::value>::type;
 
     public:
+        typedef T value_type;
+        typedef Alloc allocator_type;
+        typedef Growth growth_policy;
+
         vector(void){
-            sbegin = reinterpret_cast<T*> (operator new(sizeof(T) * min_capacity));
-            send = sbegin + min_capacity;
+            storage = initial_storage();
+            sbegin = allocate(storage);
+            send = sbegin + storage;
             dbegin = dend = sbegin;
-            storage = min_capacity;
             length = 0;
             front_storage = 0;
             reallocate_times = 0;
             vector_version = 0;
+            mark_usage();
         }
 
-        explicit vector(uint64_t n){
-            if(n == 0)  vector();
-            else
-            {
-                storage = n;
-                length = n;
-                sbegin = reinterpret_cast<T*> (operator new(sizeof(T) * storage));
-                send = sbegin + storage;
-                dbegin = sbegin;
-                dend = dbegin + length;
-                front_storage = 0;
-                for(uint64_t k = 0; k < length; k += 1){
-                    new (dbegin+k) T();
-                }
-                reallocate_times = 0;
-                vector_version = 0;
-            }
+        explicit vector(const Alloc& a) : alloc(a) {
+            storage = initial_storage();
+            sbegin = allocate(storage);
+            send = sbegin + storage;
+            dbegin = dend = sbegin;
+            length = 0;
+            front_storage = 0;
+            reallocate_times = 0;
+            vector_version = 0;
+            mark_usage();
         }
 
-        /********************constructor from initializer_list*************************/
-        vector(std::initializer_list<T> i1){
-            uint64_t storage = i1.size();
-            if (storage == 0) { storage = min_capacity; }
-            sbegin = reinterpret_cast<T*>(operator new(storage * sizeof(T)));
+        explicit vector(uint64_t n, const Alloc& a = Alloc()) : alloc(a) {
+            storage = (n == 0) ? initial_storage() : n;
+            length = n;
+            sbegin = allocate(storage);
             send = sbegin + storage;
-            dbegin = dend = sbegin;
-            for (auto iter = i1.begin(); iter != i1.end(); ++iter){
-                new (dend) T(*iter);
-                ++dend;
+            dbegin = sbegin;
+            dend = dbegin + length;
+            front_storage = 0;
+            for(uint64_t k = 0; k < length; k += 1){
+                new (dbegin+k) T();
             }
+            reallocate_times = 0;
+            vector_version = 0;
+            mark_usage();
+        }
+
+        /********************constructor from initializer_list*************************/
+        vector(std::initializer_list<T> i1, const Alloc& a = Alloc()) : alloc(a) {
             length = i1.size();
+            storage = (length == 0) ? initial_storage() : length;
+            sbegin = allocate(storage);
+            send = sbegin + storage;
+            dbegin = sbegin;
+            dend = dbegin + length;
+            construct_range(i1.begin(), length, dbegin);
             front_storage = 0;
             reallocate_times = 0;
             vector_version = 0;
+            mark_usage();
         }
 
 
          /********************constructor from iterator****************************/
         template<typename IT>
-        vector(IT b, IT e){
+        vector(IT b, IT e, const Alloc& a = Alloc()) : alloc(a) {
             typename std::iterator_traits<IT>::iterator_category x{};
             build_vector(b, e, x);
         }
 
         template<typename IT>
         void build_vector(IT& b, IT& e, std::random_access_iterator_tag x){
-            storage = e- b;
             length = e - b;
-            sbegin = reinterpret_cast<T*> (operator new(sizeof(T) * storage));
+            storage = (length == 0) ? initial_storage() : length;
+            sbegin = allocate(storage);
             send = sbegin + storage;
             dbegin = sbegin;
             dend = dbegin + length;
-            front_storage = 0; uint64_t k=0;
-            while(b != e){
-                new (dbegin+k) T(*b); b++; k++;
-            }
+            front_storage = 0;
+            construct_range(b, length, dbegin);
             reallocate_times = 0;
             vector_version = 0;
+            mark_usage();
         }
 
         template<typename IT, typename TAG>
         void build_vector(IT& b, IT& e, TAG x){
-            storage = min_capacity;
-            sbegin = reinterpret_cast<T*> (operator new(sizeof(T) * storage));
+            storage = initial_storage();
+            sbegin = allocate(storage);
             send = sbegin + storage;
             dbegin = sbegin; dend = dbegin;
             front_storage = 0; length = 0;
-            while (b != e) {
-                push_back(*b); b++; length++;
+            mark_usage();
+            append(b, e);
+            reallocate_times = 0;
+            vector_version = 0;
+        }
+
+
+
+    protected:
+        //move assignment that may move inline elements one by one and
+        //allocate; on a throw this is left empty
+        void move_from(vector&& that){
+            if(this != &that){
+                destroy();
+                reset_storage();
+                alloc = std::move(that.alloc);
+                move(std::move(that));
             }
+            reallocate_times++;
+            vector_version++;
+        }
+
+        //start out in a buffer of n elements that the caller owns
+        vector(T* buffer, uint64_t n, const Alloc& a) : alloc(a) {
+            inline_storage = buffer;
+            inline_capacity = n;
+            sbegin = dbegin = dend = buffer;
+            send = buffer + n;
+            storage = n;
+            length = 0;
+            front_storage = 0;
             reallocate_times = 0;
             vector_version = 0;
+            mark_usage();
         }
 
+        bool data_in_inline_storage(void) const{
+            return sbegin != nullptr && sbegin == inline_storage;
+        }
 
+#if EPL_VECTOR_STATS
+        //record the final size once; small_vector calls this before it
+        //clears its inline elements
+        void retire(void){
+            if(retired || sbegin == nullptr) { return; }
+            retired = true;
+            stats_detail::retire(stats_site, length, sizeof(T) * storage,
+                                 sizeof(T) * front_storage, sizeof(T) * (send - dend));
+        }
+#endif
 
+    public:
         /*********************copy construcot and assignment**************************/
-        vector(const vector<T>& that) {
+        vector(const vector& that) : alloc(that.alloc) {
             copy(that);
             reallocate_times = 0;
             vector_version = 0;
         }
 
-        vector<T>& operator=(const vector<T>& that) {
+        vector& operator=(const vector& that) {
             if(this != &that){
                 destroy();
                 copy(that);
@@ -152,15 +302,24 @@ namespace epl{
         }
 
         /*********move constructor and assigment operator  part b***************************/
-        vector(vector<T>&& that )  {
+        //Moving takes the block and leaves that empty, holding no memory.
+        //Neither can throw, so containers of vectors move them when they
+        //regrow. A small_vector whose elements are still inline has no block
+        //to hand over: they are moved one by one, into a new block if this
+        //has no inline room, and that may throw. Moves and swaps from a
+        //small_vector therefore take the overloads below, which are not
+        //noexcept. Moving one through a plain vector&& would bypass them,
+        //and must not be done while its elements are inline.
+        vector(vector&& that ) noexcept : alloc(std::move(that.alloc)) {
             move(std::move(that));
             reallocate_times = 0;
             vector_version = 0;
         }
 
-        vector<T>& operator=(vector<T>&& that){
+        vector& operator=(vector&& that) noexcept{
             if(this != &that){
                 destroy();
+                alloc = std::move(that.alloc);
                 move(std::move(that));
             }
             reallocate_times++;
@@ -168,153 +327,172 @@ namespace epl{
             return *this;
         }
 
-        ~vector(void) { destroy(); }
+        template <typename V, typename = derived_rvalue<V> >
+        vector(V&& that) : alloc(that.get_allocator()) {
+            move(static_cast<vector&&>(that));
+            reallocate_times = 0;
+            vector_version = 0;
+        }
+
+        template <typename V, typename = derived_rvalue<V> >
+        vector& operator=(V&& that){
+            move_from(std::move(that));
+            return *this;
+        }
+
+        //exchanges the contents without touching the elements. A swap with
+        //a small_vector takes the overload below or small_vector::swap; only
+        //through a plain vector& can this meet inline elements, and then it
+        //moves them (see above)
+        void swap(vector& that) noexcept{
+            if(this == &that) { return; }
+            if(data_in_inline_storage() || that.data_in_inline_storage()){
+                vector tmp(std::move(that));
+                that = std::move(*this);
+                *this = std::move(tmp);
+                return;
+            }
+            std::swap(dbegin, that.dbegin);
+            std::swap(dend, that.dend);
+            std::swap(sbegin, that.sbegin);
+            std::swap(send, that.send);
+            std::swap(length, that.length);
+            std::swap(storage, that.storage);
+            std::swap(front_storage, that.front_storage);
+            std::atomic<uint64_t>* owners = shared.load(std::memory_order_relaxed);
+            shared.store(that.shared.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            that.shared.store(owners, std::memory_order_relaxed);
+            std::swap(alloc, that.alloc);
+            mark_usage();
+            that.mark_usage();
+            reallocate_times++; that.reallocate_times++;
+            vector_version++; that.vector_version++;
+        }
+
+        template <typename V, typename = derived_rvalue<V> >
+        void swap(V& that){
+            vector tmp(std::move(that));
+            that = std::move(*this);
+            *this = std::move(tmp);
+        }
+
+        ~vector(void){
+            EPL_IF_STATS(retire();)
+            destroy();
+        }
+
+        /*********************copy-on-write snapshot***************************/
+        //A copy that shares this vector's block instead of copying it. Both
+        //stay ordinary vectors: the first one to be changed (a push, a pop,
+        //or any non-const access) copies its elements out into a block of
+        //its own, and the slack of the shared block is not copied. Sharing
+        //is counted atomically, so snapshots may be handed to other threads,
+        //and, like any const member, snapshot() may run in several threads
+        //at once. It must not overlap a non-const member call on this vector
+        //(begin() included), which may copy the block out from under it.
+        //Pointers, references and iterators taken from this vector before
+        //the snapshot must not be written through while it is shared.
+        //Elements in a small_vector's inline buffer are copied instead.
+        vector snapshot(void) const{
+            static_assert(std::is_copy_constructible<T>::value, "snapshot needs copy constructible elements");
+            if(sbegin == nullptr || data_in_inline_storage()) { return vector(*this); }
+            return vector(*this, share_tag{});
+        }
+
+        //true while the block is shared with a snapshot
+        bool is_shared(void) const{
+            std::atomic<uint64_t>* owners = shared.load(std::memory_order_acquire);
+            return owners != nullptr && owners->load(std::memory_order_acquire) > 1;
+        }
+
+        Alloc get_allocator(void) const { return alloc; }
 
         uint64_t size(void) const{
             return (dend - dbegin);
         }
 
+        //the elements as one contiguous array of size() entries
+        T* data(void) { unshare(); return dbegin; }
+        const T* data(void) const { return dbegin; }
+
         T& operator[](uint64_t k){
             if( (k + dbegin) >= dend) { throw std::out_of_range{"subscript out of range"}; }
+            unshare();
             return dbegin[k];
         }
 
-        T& operator[](uint64_t k) const{
+        const T& operator[](uint64_t k) const{
             if( (k + dbegin) >= dend) { throw std::out_of_range{"subscript out of range"}; }
             return dbegin[k];
         }
 
         void push_back(const T& that){
-            if(send == dend){
-                storage = storage * 2;
-                reallocate_times++;
-                T* sbegin1 = reinterpret_cast<T*> (operator new(sizeof(T) * storage));
-                T *send1 = sbegin1 + storage;
-                T* dbegin1 = sbegin1 + front_storage;
-                T* dend1 = dbegin1 + length;
-
-                /***********copy before being null*************************/
-                //new(dend1) T(that);
-
-                for(uint64_t k = 0; k < length; k++){
-                    //new(dbegin1+k) T((dbegin[k]));
-                    new(dbegin1+k) T( std::move(dbegin[k]));
-                }
-                new(dend1) T(that);
-                destroy();
-
-                sbegin = sbegin1; dbegin = dbegin1; dend = dend1 + 1 ; send = send1;
-                length++;
-            }
-            else{
-                new(dend) T(that);
-                dend ++;
-                length++;
-            }
-            vector_version++;
+            emplace_back(that);
         }
 
         void push_back(T&& that){
-            if(send == dend){
-                storage = storage * 2;
-                reallocate_times++;
-                T* sbegin1 = reinterpret_cast<T*> (operator new(sizeof(T) * storage));
-                T *send1 = sbegin1 + storage;
-                T* dbegin1 = sbegin1 + front_storage;
-                T* dend1 = dbegin1 + length;
+            emplace_back(std::move(that));
+        }
 
-                /************move before being null**************************/
-                new(dend1) T(std::move(that));
+        void push_front(const T& that){
+            emplace_front(that);
+        }
 
-                for(uint64_t k = 0; k < length; k++){
-                    //new(dbegin1+k) T((dbegin[k]));
-                    new(dbegin1+k) T( std::move(dbegin[k]));
-                }
-                //new(dend1) T(that);
-                destroy();
+        void push_front(T&& that){
+            emplace_front(std::move(that));
+        }
 
-                sbegin = sbegin1; dbegin = dbegin1; dend = dend1 + 1 ; send = send1;
-                length++;
+        /**********************construct in place****************************/
+        template <typename... Args>
+        T& emplace_back(Args&&... args){
+            if(sharing()) { detach(false, 1); }
+            if(send == dend){
+                grow_back(std::forward<Args>(args)...);
             }
             else{
-                //new(dend) T(that);
-                new(dend) T(std::move(that));
-                dend ++;
-                length++;
+                new(dend) T(std::forward<Args>(args)...);
             }
+            dend ++;
+            length++;
             vector_version++;
+            return dend[-1];
         }
 
-        void push_front(const T& that){
+        template <typename... Args>
+        T& emplace_front(Args&&... args){
+            if(sharing()) { detach(true, 1); }
             if(sbegin == dbegin) {
-                uint64_t old_storage = storage;
-                storage = storage * 2;
-                reallocate_times++;
-                T* sbegin1 = (T*)(operator new(sizeof(T) * storage));
-                T* send1 = sbegin1 + storage;
-                T* dbegin1 = sbegin1 + front_storage + old_storage ;
-                T* dend1 = dbegin1 + length;
-
-                /***********copy before being null******************************/
-                new(dbegin1 -1) T{that};
-
-                for(uint64_t i = 0; i < length; i++){
-                    //new(dbegin1 + i) T{dbegin[i]};
-                    new(dbegin1 + i) T{std::move(dbegin[i])};
-                }
-
-                destroy();
-
-                sbegin = sbegin1; send = send1; dbegin = dbegin1 -1; dend = dend1;
-                front_storage = front_storage + old_storage -1;
-                length++;
+                grow_front(std::forward<Args>(args)...);
             }
             else{
-                dbegin--;
-                new(dbegin) T{that};
-                length++;
-                front_storage--;
+                new(dbegin - 1) T(std::forward<Args>(args)...);
             }
+            dbegin--;
+            length++;
+            front_storage--;
             vector_version++;
+            return *dbegin;
         }
 
-        void push_front(T&& that){
-            if(sbegin == dbegin) {
-                uint64_t old_storage = storage;
-                storage = storage * 2;
-                reallocate_times++;
-                T* sbegin1 = (T*)(operator new(sizeof(T) * storage));
-                T* send1 = sbegin1 + storage;
-                T* dbegin1 = sbegin1 + front_storage + old_storage ;
-                T* dend1 = dbegin1 + length;
-
-                /***********move before being null****************************/
-                new(dbegin1 -1) T{std::move(that)};
-
-                for(uint64_t i = 0; i < length; i++){
-                    //new(dbegin1 + i) T{dbegin[i]};
-                    new(dbegin1 + i) T{std::move(dbegin[i])};
-                }
-                //new(dbegin1 -1) T{that};
-
-                destroy();
+        /**********************bulk append and prepend****************************/
+        //The range is sized first (when its iterators allow it) so the vector
+        //grows at most once. The range must not refer into this vector.
+        template <typename IT>
+        void append(IT first, IT last){
+            typename std::iterator_traits<IT>::iterator_category x{};
+            append_range(first, last, x);
+        }
 
-                sbegin = sbegin1; send = send1; dbegin = dbegin1 -1; dend = dend1;
-                front_storage = front_storage + old_storage -1;
-                length++;
-            }
-            else{
-                dbegin--;
-                //new(dbegin) T{that};
-                new(dbegin) T{std::move(that)};
-                length++;
-                front_storage--;
-            }
-            vector_version++;
+        //inserts [first, last) in order ahead of the current first element
+        template <typename IT>
+        void prepend(IT first, IT last){
+            typename std::iterator_traits<IT>::iterator_category x{};
+            prepend_range(first, last, x);
         }
 
         void pop_back(void){
             if(dbegin == dend) { throw std::out_of_range{"no data to be poped"}; }
+            unshare();
             dend--;
             dend -> ~T();
             length--;
@@ -323,6 +501,7 @@ namespace epl{
 
         void pop_front(void){
             if(dbegin == dend) { throw std::out_of_range{"no data to be poped"}; }
+            unshare();
             dbegin -> ~T();
             dbegin++;
             front_storage++;
@@ -330,34 +509,158 @@ namespace epl{
             vector_version++;
         }
 
+        /**********************capacity*********************************/
+        uint64_t capacity(void) const { return storage; }
+
+        //pushes that fit at each end without a reallocation
+        uint64_t spare_front(void) const { return front_storage; }
+        uint64_t spare_back(void) const { return send - dend; }
+
+        bool empty(void) const { return dbegin == dend; }
+
+#if EPL_VECTOR_STATS
+        /**********************statistics*********************************/
+        //growths of this vector so far, and its slack right now
+        vector_stats stats(void) const{
+            vector_stats s = counters;
+            if(sizeof(T) * storage > s.peak_capacity) { s.peak_capacity = sizeof(T) * storage; }
+            s.front_slack = sizeof(T) * front_storage;
+            s.back_slack = sizeof(T) * (send - dend);
+            return s;
+        }
+
+        //names this vector in growth events and in the final size
+        //histograms; site must outlive the vector (EPL_VECTOR_SITE does)
+        void set_stats_site(const char* site) { stats_site = site; }
+#endif
+
+        //room for n elements counting from the current front: n - size()
+        //push_backs will not reallocate. The front slack is kept.
+        void reserve(uint64_t n){
+            if(sharing()) { detach(false, (n > length) ? n - length : 0); }
+            if(n <= length || uint64_t(send - dend) >= n - length) { return; }
+            EPL_IF_STATS(growing = growth_end::back;)
+            regrow(front_storage + n, front_storage);
+            vector_version++;
+        }
+
+        //room for n elements counting from the current back: n - size()
+        //push_fronts will not reallocate. The back slack is kept.
+        void reserve_front(uint64_t n){
+            if(sharing()) { detach(true, (n > length) ? n - length : 0); }
+            if(n <= length || front_storage >= n - length) { return; }
+            uint64_t back = send - dend;
+            EPL_IF_STATS(growing = growth_end::front;)
+            regrow(n + back, n - length);
+            vector_version++;
+        }
+
+        //Lets I/O write straight into the back slack: back_buffer(n) makes room
+        //for n more elements and returns where the next one goes, and
+        //commit_back(k) then takes the first k of them as elements. Only for
+        //trivially copyable T, which any bytes written there form validly.
+        T* back_buffer(uint64_t n){
+            static_assert(std::is_trivially_copyable<T>::value, "back_buffer needs trivially copyable elements");
+            if(sharing()) { detach(false, n); }
+            reserve_back_room(n);
+            vector_version++;
+            return dend;
+        }
+
+        void commit_back(uint64_t k){
+            static_assert(std::is_trivially_copyable<T>::value, "commit_back needs trivially copyable elements");
+            unshare();
+            if(k > uint64_t(send - dend)) { throw std::out_of_range{"commit beyond the back buffer"}; }
+            dend += k;
+            length += k;
+            vector_version++;
+        }
+
+        //drop the slack at both ends, or move back into the inline buffer
+        void shrink_to_fit(void){
+            unshare();
+            if(storage == length || sbegin == inline_storage) { return; }
+            EPL_IF_STATS(growing = growth_end::other;)
+            if(length == 0){
+                deallocate(sbegin, storage);
+                reset_storage();
+                reallocate_times++;
+            }
+            else if(length <= inline_capacity){
+                relocate(inline_storage, inline_capacity, 0);
+            }
+            else{
+                regrow(length, 0);
+            }
+            vector_version++;
+        }
+
+        void resize(uint64_t n){
+            resize_back(n, [](T* p) { new(p) T(); });
+        }
+
+        void resize(uint64_t n, const T& value){
+            if(n > length && owns(std::addressof(value))){
+                T copy_of_value(value);
+                resize(n, copy_of_value);
+                return;
+            }
+            resize_back(n, [&value](T* p) { new(p) T(value); });
+        }
+
+        //destroy every element; the storage and its front/back split are kept,
+        //unless it is shared, which is let go of without copying anything
+        void clear(void){
+            if(sharing()){
+                destroy();
+                reset_storage();
+                reallocate_times++;
+                vector_version++;
+                return;
+            }
+            while(dend != dbegin){
+                dend--;
+                dend -> ~T();
+            }
+            length = 0;
+            vector_version++;
+        }
+
         class const_iterator;
         /**********************iterator class*********************************/
+        // With EPL_CHECKED_ITERATORS the iterator remembers the version of its
+        // parent and throws invalid_iterator on use after a modification.
+        // Without it the iterator is nothing but a T* and every operation
+        // compiles down to the matching pointer operation.
         class iterator{
         private:
             T* ptr;
+#if EPL_CHECKED_ITERATORS
             uint64_t index;
             uint64_t iterator_version;
             uint64_t record_reallocate_times;
-            vector<T>* parent;
+            vector* parent;
             uint64_t inside;   //to keep state of iterator whether it was out of bound previously
+#endif
 
             friend class const_iterator;
 
         public:
             typedef T value_type;
             typedef std::random_access_iterator_tag iterator_category;
-            typedef int difference_type;
+            typedef std::ptrdiff_t difference_type;
             typedef T*  pointer;
             typedef T& reference;
 
 
+#if EPL_CHECKED_ITERATORS
             iterator(void) {
                 ptr = NULL; parent = NULL;
                 index = 0;  iterator_version = 0; record_reallocate_times = 0;
                 inside = 1;
             }
 
-            iterator(vector<T>* parent ,T* ptr){
+            iterator(vector* parent ,T* ptr){
                 this->ptr = ptr;
                 this->index = ptr - parent->dbegin;
                 this->iterator_version = parent->vector_version;
@@ -367,26 +670,20 @@ namespace epl{
                     this->inside = 1;
                 else this->inside = 0;
             }
+#else
+            iterator(void) { ptr = NULL; }
 
-            /*iterator(iterator& it){
-                this->ptr = it.ptr;
-                this->index = it.index;
-                this->iterator_version = it.iterator_version;
-                this->record_reallocate_times = it.record_reallocate_times;
-                this->parent = it.parent;
-                this->inside = it.inside;
-            }*/
+            iterator(vector*, T* ptr) { this->ptr = ptr; }
+#endif
 
-            T& operator*(void) {  check_exception();  return *ptr; }
-            T* operator->(void) {  check_exception();  return ptr ; }
-            T& operator[](uint64_t k) { check_exception(); return *(ptr+k); }
-            const T& operator[](uint64_t k) const { check_exception(); return *(ptr+k); }
+            T& operator*(void) const {  check_exception();  return *ptr; }
+            T* operator->(void) const {  check_exception();  return ptr ; }
+            T& operator[](int64_t k) const { check_exception(); return *(ptr+k); }
 
             iterator& operator++() {
                 check_exception();
                 ptr++;
-                index++;
-                update_inside();
+                advance_index(1);
                 return *this;
             }
 
@@ -410,8 +707,7 @@ namespace epl{
             iterator& operator--(){
                 check_exception();
                 ptr--;
-                index--;
-                update_inside();
+                advance_index(-1);
                 return *this;
             }
 
@@ -422,61 +718,53 @@ namespace epl{
                 return tmp;
             }
 
-            iterator operator+(int64_t k){
-                check_exception();
+            iterator operator+(int64_t k) const{
                 iterator tmp{*this};
-                tmp.ptr +=k;
-                tmp.index +=k;
-                update_inside();
+                tmp += k;
                 return tmp;
             }
 
             iterator& operator+=(int64_t k){
                 check_exception();
                 ptr +=k;
-                index +=k;
-                update_inside();
+                advance_index(k);
                 return *this;
             }
 
-            iterator operator-(int64_t k){
-                check_exception();
+            iterator operator-(int64_t k) const{
                 iterator tmp{*this};
-                tmp.ptr -=k;
-                tmp.index -=k;
-                update_inside();
+                tmp -= k;
                 return tmp;
             }
 
             iterator& operator-=(int64_t k){
                 check_exception();
                 ptr -=k;
-                index -=k;
-                update_inside();
+                advance_index(-k);
                 return *this;
             }
 
-            int64_t operator-(iterator& it){
+            int64_t operator-(const iterator& it) const{
                 return this->ptr - it.ptr;
             }
 
-            bool operator<(iterator& it){
-                return (this->index < it.index);
+            bool operator<(const iterator& it) const{
+                return (this->ptr < it.ptr);
             }
 
-            bool operator>=(iterator& it){
-                return (!(this->index < it.index));
+            bool operator>=(const iterator& it) const{
+                return (!(this->ptr < it.ptr));
             }
 
-            bool operator>(iterator& it){
-                return (this->index > it.index);
+            bool operator>(const iterator& it) const{
+                return (this->ptr > it.ptr);
             }
 
-            bool operator<=(iterator& it){
-                return (!(this->index > it.index));
+            bool operator<=(const iterator& it) const{
+                return (!(this->ptr > it.ptr));
             }
 
-            // others remain to be implemented
+#if EPL_CHECKED_ITERATORS
             void check_exception() const{
                 if(iterator_version != parent->vector_version){
                     if(record_reallocate_times != parent->reallocate_times)
@@ -488,12 +776,17 @@ namespace epl{
                 }
             }
 
-            void update_inside(){
+            void advance_index(int64_t k){
+                index += k;
                 if(  (index >= 0)&&(index < parent->size()   ))
                    inside = 1;
                 else
                    inside = 0;
             }
+#else
+            void check_exception() const {}
+            void advance_index(int64_t) {}
+#endif
 
         };
         /*********************iterator class***********************************/
@@ -503,26 +796,29 @@ namespace epl{
         class const_iterator{
         private:
             const T* ptr;
+#if EPL_CHECKED_ITERATORS
             uint64_t index;
             uint64_t iterator_version;
             uint64_t record_reallocate_times;
-            const vector<T>* parent;
+            const vector* parent;
             uint64_t inside;
+#endif
 
         public:
             typedef T value_type;
             typedef std::random_access_iterator_tag iterator_category;
-            typedef int difference_type;
-            typedef T*  pointer;
-            typedef T& reference;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T*  pointer;
+            typedef const T& reference;
 
+#if EPL_CHECKED_ITERATORS
             const_iterator(void){
                 ptr = NULL; parent = NULL;
                 index = 0;  iterator_version = 0; record_reallocate_times = 0;
                 inside = 1;
             }
 
-            const_iterator(const vector<T>* parent ,const T* ptr){
+            const_iterator(const vector* parent ,const T* ptr){
                 this->ptr = ptr;
                 this->index = ptr - parent->dbegin;
                 this->iterator_version = parent->vector_version;
@@ -540,19 +836,23 @@ namespace epl{
                 this->record_reallocate_times = it.record_reallocate_times;
                 this->parent = it.parent;
                 this->inside = it.inside;
-            }  //how to write this function
+            }
+#else
+            const_iterator(void) { ptr = NULL; }
+
+            const_iterator(const vector*, const T* ptr) { this->ptr = ptr; }
+
+            const_iterator(const iterator& it) { this->ptr = it.ptr; }
+#endif
 
-            //const_iterator& operator=(iterator& it) {}
             const T& operator*(void) const{  check_exception();  return *ptr; }
             const T* operator->(void) const{  check_exception();  return ptr ; }
-            //T& operator[](uint64_t k) { check_exception(); return *(ptr+k); }
-            const T& operator[](uint64_t k) const { check_exception(); return *(ptr+k); }
+            const T& operator[](int64_t k) const { check_exception(); return *(ptr+k); }
 
             const_iterator& operator++() {
                 check_exception();
                 ptr++;
-                index++;
-                update_inside();
+                advance_index(1);
                 return *this;
             }
 
@@ -576,8 +876,7 @@ namespace epl{
             const_iterator& operator--(){
                 check_exception();
                 ptr--;
-                index--;
-                update_inside();
+                advance_index(-1);
                 return *this;
             }
 
@@ -588,61 +887,53 @@ namespace epl{
                 return tmp;
             }
 
-            const_iterator operator+(int64_t k){
-                check_exception();
+            const_iterator operator+(int64_t k) const{
                 const_iterator tmp{*this};
-                tmp.ptr +=k;
-                tmp.index +=k;
-                update_inside();
+                tmp += k;
                 return tmp;
             }
 
             const_iterator& operator+=(int64_t k){
                 check_exception();
                 ptr +=k;
-                index +=k;
-                update_inside();
+                advance_index(k);
                 return *this;
             }
 
-            const_iterator operator-(int64_t k){
-                check_exception();
+            const_iterator operator-(int64_t k) const{
                 const_iterator tmp{*this};
-                tmp.ptr -=k;
-                tmp.index -=k;
-                update_inside();
+                tmp -= k;
                 return tmp;
             }
 
             const_iterator& operator-=(int64_t k){
                 check_exception();
                 ptr -=k;
-                index -=k;
-                update_inside();
+                advance_index(-k);
                 return *this;
             }
 
-            int64_t operator-(const_iterator& it){
+            int64_t operator-(const const_iterator& it) const{
                 return this->ptr - it.ptr;
             }
 
-            bool operator<(const_iterator& it){
-                return (this->index < it.index);
+            bool operator<(const const_iterator& it) const{
+                return (this->ptr < it.ptr);
             }
 
-            bool operator>=(const_iterator& it){
-                return (!(this->index < it.index));
+            bool operator>=(const const_iterator& it) const{
+                return (!(this->ptr < it.ptr));
             }
 
-            bool operator>(const_iterator& it){
-                return (this->index > it.index);
+            bool operator>(const const_iterator& it) const{
+                return (this->ptr > it.ptr);
             }
 
-            bool operator<=(const_iterator& it){
-                return (!(this->index > it.index));
+            bool operator<=(const const_iterator& it) const{
+                return (!(this->ptr > it.ptr));
             }
 
-            // others remain to be implemented
+#if EPL_CHECKED_ITERATORS
             void check_exception() const{
                 if(iterator_version != parent->vector_version){
                     if(record_reallocate_times != parent->reallocate_times)
@@ -654,12 +945,17 @@ namespace epl{
                 }
             }
 
-            void update_inside(){
+            void advance_index(int64_t k){
+                index += k;
                 if(  (index >= 0)&&(index < parent->size()  ))
                    inside = 1;
-                   else
+                else
                    inside = 0;
             }
+#else
+            void check_exception() const {}
+            void advance_index(int64_t) {}
+#endif
         };
         /*********************const_iterator class******************************/
 
@@ -675,10 +971,12 @@ namespace epl{
         }
 
         iterator begin(void){
+            unshare();
             return iterator(this, dbegin);
         }
 
         iterator end(void){
+            unshare();
             return iterator(this, dend);
         }
         /**********************begin and end*********************************/
@@ -687,52 +985,545 @@ namespace epl{
 
 
     private:
+        struct share_tag {};
+
+        //The snapshot constructor: take a share of that's block. Readers of
+        //that may snapshot it at the same time, so the first counter is
+        //installed with a compare-exchange and a losing one is thrown away.
+        vector(const vector& that, share_tag) : alloc(that.alloc) {
+            std::atomic<uint64_t>* owners = shared_counter(that);
+            owners->fetch_add(1, std::memory_order_relaxed);
+            shared.store(owners, std::memory_order_relaxed);
+            sbegin = that.sbegin; send = that.send;
+            dbegin = that.dbegin; dend = that.dend;
+            length = that.length;
+            storage = that.storage;
+            front_storage = that.front_storage;
+            reallocate_times = 0;
+            vector_version = 0;
+            mark_usage();
+        }
+
+        static std::atomic<uint64_t>* shared_counter(const vector& that){
+            std::atomic<uint64_t>* owners = that.shared.load(std::memory_order_acquire);
+            if(owners != nullptr) { return owners; }
+            std::atomic<uint64_t>* fresh = new std::atomic<uint64_t>(1);
+            if(that.shared.compare_exchange_strong(owners, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) { return fresh; }
+            delete fresh;
+            return owners;
+        }
+
+        //give up this vector's share of the block; true if it was the last
+        bool release_share(void){
+            std::atomic<uint64_t>* owners = shared.load(std::memory_order_acquire);
+            shared.store(nullptr, std::memory_order_relaxed);
+            if(owners->fetch_sub(1, std::memory_order_acq_rel) != 1) { return false; }
+            delete owners;
+            return true;
+        }
+
+        //The owner's own test; only the owner ever clears shared, so a
+        //relaxed load is enough here and the copy reloads it with acquire
+        bool sharing(void) const { return shared.load(std::memory_order_relaxed) != nullptr; }
+
+        //The check every non-const access makes, with the copy out of line:
+        //a range-for is a test in begin() and end(), then the same loop as
+        //over a pointer. A loop that calls end() on every pass keeps a load
+        //and a branch per pass; taking end() once avoids that.
+        void unshare(void){
+            if(EPL_UNLIKELY(sharing())) { unshare_slow(); }
+        }
+
+        EPL_COLD void unshare_slow(void) { detach(false, 0); }
+
+        //Called before the first change to a shared block. The last owner
+        //keeps the block; any other copies the elements, and nothing else,
+        //into a block of its own with room for n more at the front or back.
+        void detach(bool at_front, uint64_t n){
+            std::atomic<uint64_t>* owners = shared.load(std::memory_order_acquire);
+            if(owners->load(std::memory_order_acquire) == 1){
+                delete owners;
+                shared.store(nullptr, std::memory_order_relaxed);
+                return;
+            }
+            uint64_t new_storage = length + n;
+            if(n != 0){
+                uint64_t grown = (length == 0) ? initial_storage() : Growth::template next<T>(length);
+                if(grown > new_storage) { new_storage = grown; }
+            }
+            if(new_storage == 0) { new_storage = initial_storage(); }
+            uint64_t new_front = (n == 0) ? 0 : split_front(new_storage, at_front, n);
+            T* block = allocate(new_storage);
+            try { copy_shared(block + new_front, std::is_copy_constructible<T>{}); }
+            catch(...) { deallocate(block, new_storage); throw; }
+            destroy();
+            sbegin = block; send = block + new_storage;
+            dbegin = block + new_front; dend = dbegin + length;
+            storage = new_storage; front_storage = new_front;
+            reallocate_times++;
+            vector_version++;
+            mark_usage();
+        }
+
+        void copy_shared(T* dst, std::true_type){
+            construct_range(static_cast<const T*>(dbegin), length, dst);
+        }
+
+        //never called: snapshot() does not compile for such elements
+        void copy_shared(T*, std::false_type) {}
+
+        //destroys the elements and frees the block, or just lets go of a
+        //block that is still shared
         void destroy(){
-        	T* tmp = dbegin;
-            while(tmp != dend){
-                tmp -> ~T();
-                tmp++;
+            if(sharing() && !release_share()) { return; }
+            if(!std::is_trivially_destructible<T>::value){
+                T* tmp = dbegin;
+                while(tmp != dend){
+                    tmp -> ~T();
+                    tmp++;
+                }
             }
-            operator delete(sbegin);
+            deallocate(sbegin, storage);
         }
 
-        void copy(const vector<T>& that){
+        void copy(const vector& that){
             length = that.length;
             storage = that.storage;
             front_storage = that.front_storage;
-            sbegin = (T*) (operator new(sizeof(T) * storage));
+            if(inline_storage != nullptr && length <= inline_capacity){
+                storage = inline_capacity;
+                if(front_storage > storage - length) { front_storage = storage - length; }
+                sbegin = inline_storage;
+            }
+            else{
+                sbegin = allocate(storage);
+            }
             send = sbegin + storage;
             dbegin = sbegin + front_storage;
             dend = dbegin  + length;
 
-            for(uint64_t k = 0; k < length ; k++){
-                //  error dbegin[k] = that.dbegin[k];
-            	new (dbegin + k)  T(that.dbegin[k]);
-            }
+            construct_range(static_cast<const T*>(that.dbegin), length, dbegin);
+            mark_usage();
         }
 
         /********************move  part b***************************/
-        void move(vector<T>&& that){
-            length = that.length;
-            front_storage = that.front_storage;
-            storage = that.storage;
+        void move(vector&& that){
+            if(that.sbegin != nullptr && that.sbegin == that.inline_storage){
+                take_elements(that);
+            }
+            else{
+                length = that.length;
+                front_storage = that.front_storage;
+                storage = that.storage;
+
+                sbegin = that.sbegin;
+                send = that.send;
+                dbegin = that.dbegin;
+                dend = that.dend;
+                shared.store(that.shared.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+                that.reset_storage();
+            }
+
+            mark_usage();
+            vector_version++;
+        }
+
+        //that keeps its elements in its own inline buffer: move them one by
+        //one. This is left as it was if the allocation or a move throws.
+        void take_elements(vector& that){
+            uint64_t n = that.length, room;
+            T* block;
+            if(inline_storage != nullptr && n <= inline_capacity){
+                room = inline_capacity;
+                block = inline_storage;
+            }
+            else{
+                room = (n < initial_storage()) ? initial_storage() : n;
+                block = allocate(room);
+            }
+            if(relocatable){
+                if(n != 0) { std::memcpy(static_cast<void*>(block), static_cast<void*>(that.dbegin), sizeof(T) * n); }
+            }
+            else{
+                try { construct_range(std::make_move_iterator(that.dbegin), n, block); }
+                catch(...) { deallocate(block, room); throw; }
+                for(T* p = that.dbegin; p != that.dend; p++) { p -> ~T(); }
+            }
+            length = n;
+            front_storage = 0;
+            storage = room;
+            sbegin = block;
+            send = sbegin + storage;
+            dbegin = sbegin;
+            dend = dbegin + length;
+            that.dend = that.dbegin;
+            that.length = 0;
+            that.reset_storage();
+        }
+
+        //forget the current block: back to the inline buffer, or to nothing
+        void reset_storage(void){
+            sbegin = send = dbegin = dend = inline_storage;
+            shared.store(nullptr, std::memory_order_relaxed);
+            storage = 0;
+            if(inline_storage != nullptr){
+                send = inline_storage + inline_capacity;
+                storage = inline_capacity;
+            }
+            length = 0;
+            front_storage = 0;
+            mark_usage();
+        }
+
+        /********************raw storage and relocation***************************/
+        T* allocate(uint64_t n){
+            return alloc.allocate(n);
+        }
+
+        void deallocate(T* p, uint64_t n){
+            if(p != nullptr && p != inline_storage) { alloc.deallocate(p, n); }
+        }
+
+        //resize the current block keeping its contents, when the allocator can
+        T* reallocate(uint64_t new_storage, std::true_type){
+            return alloc.reallocate(sbegin, storage, new_storage);
+        }
+
+        T* reallocate(uint64_t, std::false_type){
+            return nullptr;
+        }
+
+        uint64_t grown_storage(void) const{
+            if(storage == 0) { return initial_storage(); }
+            uint64_t n = Growth::template next<T>(storage);
+            return (n > storage) ? n : storage + 1;
+        }
+
+        //capacity of a fresh block
+        static uint64_t initial_storage(void){
+            uint64_t n = Growth::template initial<T>();
+            return (n == 0) ? 1 : n;
+        }
+
+        bool owns(const void* p) const{
+            return std::less_equal<const void*>()(dbegin, p) && std::less<const void*>()(p, dend);
+        }
+
+        //copy-construct n elements from b into raw memory at dst
+        template <typename IT>
+        static void construct_range(IT b, uint64_t n, T* dst){
+            typedef typename std::remove_cv<typename std::remove_pointer<IT>::type>::type source_type;
+            typedef std::integral_constant<bool, std::is_pointer<IT>::value
+                && std::is_same<source_type, T>::value
+                && std::is_trivially_copyable<T>::value> bitwise;
+            construct_range(b, n, dst, bitwise{});
+        }
+
+        template <typename IT>
+        static void construct_range(IT b, uint64_t n, T* dst, std::true_type){
+            if(n != 0) { std::memcpy(static_cast<void*>(dst), b, sizeof(T) * n); }
+        }
+
+        template <typename IT>
+        static void construct_range(IT b, uint64_t n, T* dst, std::false_type){
+            uint64_t k = 0;
+            try{
+                for(; k < n; k++, ++b){
+                    new (dst + k) T(*b);
+                }
+            }
+            catch(...){
+                while(k != 0) { dst[--k].~T(); }
+                throw;
+            }
+        }
+
+        //Move the live elements into block (new_storage elements long) so the
+        //first one lands new_front slots in, then release the old block.
+        //Elements whose move may throw are copied instead, when they can be:
+        //if a copy throws, the vector is left as it was and the caller still
+        //owns block.
+        void relocate(T* block, uint64_t new_storage, uint64_t new_front){
+            EPL_IF_STATS(uint64_t old_storage = storage;)
+            T* dbegin1 = block + new_front;
+            if(relocatable){
+                if(length != 0) { std::memcpy(static_cast<void*>(dbegin1), static_cast<void*>(dbegin), sizeof(T) * length); }
+                deallocate(sbegin, storage);
+            }
+            else{
+                uint64_t k = 0;
+                try{
+                    for(; k < length; k++){
+                        new(dbegin1+k) T( std::move_if_noexcept(dbegin[k]));
+                    }
+                }
+                catch(...){
+                    while(k != 0) { dbegin1[--k].~T(); }
+                    throw;
+                }
+                destroy();
+            }
+            sbegin = block; send = block + new_storage;
+            dbegin = dbegin1; dend = dbegin1 + length;
+            storage = new_storage; front_storage = new_front;
+            reallocate_times++;
+            mark_usage();
+            EPL_IF_STATS(note_growth(old_storage, sizeof(T) * length);)
+        }
 
-            sbegin = that.sbegin;
-            send = that.send;
-            dbegin = that.dbegin;
-            dend = that.dend;
+#if EPL_VECTOR_STATS
+        void note_growth(uint64_t old_storage, uint64_t moved_bytes){
+            growth_event e;
+            e.vector = this;
+            e.site = stats_site;
+            e.end = growing;
+            e.element_size = sizeof(T);
+            e.size = length;
+            e.old_capacity = sizeof(T) * old_storage;
+            e.new_capacity = sizeof(T) * storage;
+            e.bytes_relocated = moved_bytes;
+            stats_detail::growth(counters, e);
+        }
+#endif
 
-            that.sbegin = nullptr;
-            that.send = nullptr;
-            that.dbegin = nullptr;
-            that.dend = nullptr;
+        //resize to new_storage with the data starting new_front slots in
+        void regrow(uint64_t new_storage, uint64_t new_front){
+            if(relocatable && has_reallocate<Alloc>::value && sbegin != nullptr && sbegin != inline_storage && new_front == front_storage){
+                /***********the block keeps its layout, so realloc may extend it in place******/
+                EPL_IF_STATS(uint64_t old_storage = storage; T* old_block = sbegin;)
+                T* block = reallocate(new_storage, has_reallocate<Alloc>{});
+                sbegin = block; send = block + new_storage;
+                dbegin = block + front_storage; dend = dbegin + length;
+                storage = new_storage;
+                reallocate_times++;
+                mark_usage();
+                EPL_IF_STATS(note_growth(old_storage, (block == old_block) ? 0 : sizeof(T) * length);)
+            }
+            else{
+                T* block = allocate(new_storage);
+                try { relocate(block, new_storage, new_front); }
+                catch(...) { deallocate(block, new_storage); throw; }
+            }
+        }
 
+        //grow or shrink at the back; construct(p) builds one new element at p
+        template <typename F>
+        void resize_back(uint64_t n, F construct){
+            if(sharing()) { detach(false, (n > length) ? n - length : 0); }
+            while(length > n){
+                dend--;
+                dend -> ~T();
+                length--;
+            }
+            if(n > length){
+                reserve_back_room(n - length);
+                for(; length < n; length++){
+                    construct(dend);
+                    dend++;
+                }
+            }
+            vector_version++;
+        }
+
+        /********************growth layout***************************/
+        //Net number of slots each end has taken since the last regrow. The
+        //spare space of the next block is split between the two ends in the
+        //same proportion, so a double-ended workload keeps room on both sides
+        //and a push_back-only one keeps none at the front.
+        void mark_usage(void){
+            front_mark = front_storage;
+            back_mark = send - dend;
+        }
+
+        //size and layout of the next block when one end needs n more slots
+        void plan_growth(bool at_front, uint64_t n, uint64_t& new_storage, uint64_t& new_front) const{
+            new_storage = grown_storage();
+            if(new_storage < length + n) { new_storage = length + n; }
+            new_front = split_front(new_storage, at_front, n);
+        }
+
+        //slots to leave ahead of the data in a block of new_storage elements
+        uint64_t split_front(uint64_t new_storage, bool at_front, uint64_t n) const{
+            uint64_t back = send - dend;
+            uint64_t front_used = (front_mark > front_storage) ? front_mark - front_storage : 0;
+            uint64_t back_used = (back_mark > back) ? back_mark - back : 0;
+            if(at_front) { front_used += n; } else { back_used += n; }
+            uint64_t spare = new_storage - length - n;
+            uint64_t front_spare = (uint64_t)((long double)spare * front_used / (front_used + back_used));
+            return front_spare + (at_front ? n : 0);
+        }
+
+        //One end is full but the block is not: move the data within the block
+        //instead of growing it. On the heap this is done only while the block
+        //is at most half full, so the pushes that follow a move pay for it.
+        //A FIFO (push_back + pop_front) of bounded size therefore settles in a
+        //block of twice its size and stops allocating. Elements whose move may
+        //throw go to a new block instead, where a failure can be undone.
+        bool can_recenter(void) const{
+            if(!relocatable && !std::is_nothrow_move_constructible<T>::value) { return false; }
+            if(data_in_inline_storage()) { return length < storage; }
+            return length <= storage / 2 && sbegin != nullptr;
+        }
+
+        void recenter(bool at_front){
+            uint64_t new_front = split_front(storage, at_front, 1);
+            T* dbegin1 = sbegin + new_front;
+            if(relocatable){
+                std::memmove(static_cast<void*>(dbegin1), static_cast<void*>(dbegin), sizeof(T) * length);
+            }
+            else if(dbegin1 < dbegin){
+                for(uint64_t k = 0; k < length; k++){
+                    new(dbegin1 + k) T(std::move(dbegin[k]));
+                    dbegin[k].~T();
+                }
+            }
+            else{
+                for(uint64_t k = length; k-- != 0; ){
+                    new(dbegin1 + k) T(std::move(dbegin[k]));
+                    dbegin[k].~T();
+                }
+            }
+            dbegin = dbegin1; dend = dbegin1 + length;
+            front_storage = new_front;
+            reallocate_times++;
+            mark_usage();
+            EPL_IF_STATS(growing = at_front ? growth_end::front : growth_end::back;)
+            EPL_IF_STATS(note_growth(storage, sizeof(T) * length);)
+        }
+
+        //make room for n more elements after dend
+        void reserve_back_room(uint64_t n){
+            if(uint64_t(send - dend) >= n) { return; }
+            EPL_IF_STATS(growing = growth_end::back;)
+            uint64_t new_storage, new_front;
+            plan_growth(false, n, new_storage, new_front);
+            regrow(new_storage, new_front);
+        }
+
+        //make room for n more elements before dbegin
+        void reserve_front_room(uint64_t n){
+            if(front_storage >= n) { return; }
+            EPL_IF_STATS(growing = growth_end::front;)
+            uint64_t new_storage, new_front;
+            plan_growth(true, n, new_storage, new_front);
+            regrow(new_storage, new_front);
+        }
+
+        //grow and construct the new last element at dend, leaving dend unchanged
+        template <typename... Args>
+        void grow_back(Args&&... args){
+            EPL_IF_STATS(growing = growth_end::back;)
+            if(can_recenter()){
+                /***********build aside, the arguments may point at elements being moved******/
+                T tmp(std::forward<Args>(args)...);
+                recenter(false);
+                new(dend) T(std::move(tmp));
+                return;
+            }
+            uint64_t new_storage, new_front;
+            plan_growth(false, 1, new_storage, new_front);
+            if(relocatable){
+                /***********build aside, the arguments may point into the old block******/
+                typename std::aligned_storage<sizeof(T), alignof(T)>::type tmp;
+                new(&tmp) T(std::forward<Args>(args)...);
+                try { regrow(new_storage, new_front); }
+                catch(...) { reinterpret_cast<T*>(&tmp)->~T(); throw; }
+                std::memcpy(static_cast<void*>(dend), &tmp, sizeof(T));
+                return;
+            }
+            T* block = allocate(new_storage);
+            /***********construct before the old elements are moved from******/
+            try { new(block + new_front + length) T(std::forward<Args>(args)...); }
+            catch(...) { deallocate(block, new_storage); throw; }
+            try { relocate(block, new_storage, new_front); }
+            catch(...) { block[new_front + length].~T(); deallocate(block, new_storage); throw; }
+        }
+
+        //grow and construct the new first element at dbegin - 1, leaving dbegin unchanged
+        template <typename... Args>
+        void grow_front(Args&&... args){
+            EPL_IF_STATS(growing = growth_end::front;)
+            if(can_recenter()){
+                T tmp(std::forward<Args>(args)...);
+                recenter(true);
+                new(dbegin - 1) T(std::move(tmp));
+                return;
+            }
+            uint64_t new_storage, new_front;
+            plan_growth(true, 1, new_storage, new_front);
+            if(relocatable){
+                typename std::aligned_storage<sizeof(T), alignof(T)>::type tmp;
+                new(&tmp) T(std::forward<Args>(args)...);
+                try { regrow(new_storage, new_front); }
+                catch(...) { reinterpret_cast<T*>(&tmp)->~T(); throw; }
+                std::memcpy(static_cast<void*>(dbegin - 1), &tmp, sizeof(T));
+                return;
+            }
+            T* block = allocate(new_storage);
+            /***********construct before the old elements are moved from******/
+            try { new(block + new_front - 1) T(std::forward<Args>(args)...); }
+            catch(...) { deallocate(block, new_storage); throw; }
+            try { relocate(block, new_storage, new_front); }
+            catch(...) { block[new_front - 1].~T(); deallocate(block, new_storage); throw; }
+        }
+
+        template <typename IT>
+        void append_range(IT first, IT last, std::input_iterator_tag){
+            for(; first != last; ++first){
+                emplace_back(*first);
+            }
+        }
+
+        template <typename IT>
+        void append_range(IT first, IT last, std::forward_iterator_tag){
+            uint64_t n = std::distance(first, last);
+            if(n == 0) { return; }
+            if(sharing()) { detach(false, n); }
+            reserve_back_room(n);
+            construct_range(first, n, dend);
+            dend += n;
+            length += n;
+            vector_version++;
+        }
+
+        template <typename IT>
+        void prepend_range(IT first, IT last, std::input_iterator_tag){
+            vector tmp(alloc);
+            tmp.append_range(first, last, std::input_iterator_tag{});
+            prepend_range(std::make_move_iterator(tmp.dbegin), std::make_move_iterator(tmp.dend),
+                          std::forward_iterator_tag{});
+        }
+
+        template <typename IT>
+        void prepend_range(IT first, IT last, std::forward_iterator_tag){
+            uint64_t n = std::distance(first, last);
+            if(n == 0) { return; }
+            if(sharing()) { detach(true, n); }
+            reserve_front_room(n);
+            construct_range(first, n, dbegin - n);
+            dbegin -= n;
+            front_storage -= n;
+            length += n;
             vector_version++;
         }
 
 
     };
 
+    template <typename T, typename A, typename G>
+    void swap(vector<T, A, G>& a, vector<T, A, G>& b) noexcept { a.swap(b); }
+
+} //namespace EPL_ITERATOR_NAMESPACE
+
+    //A vector is its pointers into a block on the heap, so it can be moved
+    //with memcpy as long as its allocator can: a vector of vectors regrows
+    //without touching the inner vectors' elements. (A small_vector, which
+    //may point into itself, is not covered.)
+    template <typename T, typename A, typename G>
+    struct is_trivially_relocatable<vector<T, A, G> >
+        : std::integral_constant<bool, std::is_trivially_copyable<A>::value> {};
+
 } //namespace epl
 
 #endif
@@ -0,0 +1,158 @@
+#ifndef _VECTOR_STATS_H_
+#define _VECTOR_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+//Growth statistics for epl::vector, compiled in only when
+//EPL_VECTOR_STATS is 1 (Vector.h includes this header then). With it off,
+//vector carries no extra members and runs no extra code.
+//
+//A growth is any time the elements move: a new block, a realloc, or a
+//shift inside the block to reclaim slack at the other end. Each one is
+//charged to the end whose push or reserve caused it (shrink_to_fit counts
+//as neither). Everything is measured in bytes so that figures for vectors
+//of different element types add up.
+
+#define EPL_STRINGIFY_(x) #x
+#define EPL_STRINGIFY(x) EPL_STRINGIFY_(x)
+
+//a call-site name for vector::set_stats_site: "file.cpp:123"
+#define EPL_VECTOR_SITE __FILE__ ":" EPL_STRINGIFY(__LINE__)
+
+namespace epl{
+
+    enum class growth_end { other, front, back };
+
+    struct vector_stats{
+        uint64_t front_growths;
+        uint64_t back_growths;
+        uint64_t other_growths;
+        uint64_t bytes_relocated;       //element bytes copied or moved by growths
+        uint64_t peak_capacity;         //largest block held, in bytes
+        uint64_t front_slack;           //unused bytes ahead of the data
+        uint64_t back_slack;            //unused bytes after the data
+    };
+
+    //one growth, as passed to the hook
+    struct growth_event{
+        const void* vector;
+        const char* site;               //set_stats_site(), or nullptr
+        growth_end end;
+        uint64_t element_size;
+        uint64_t size;                  //elements
+        uint64_t old_capacity;          //bytes
+        uint64_t new_capacity;          //bytes
+        uint64_t bytes_relocated;
+    };
+
+    typedef void (*growth_hook)(const growth_event&);
+
+    //counts of final sizes: bucket 0 holds size 0, bucket b sizes in
+    //[2^(b-1), 2^b)
+    typedef std::array<uint64_t, 65> size_histogram;
+
+namespace stats_detail{
+
+    struct totals{
+        std::atomic<uint64_t> front_growths{0};
+        std::atomic<uint64_t> back_growths{0};
+        std::atomic<uint64_t> other_growths{0};
+        std::atomic<uint64_t> bytes_relocated{0};
+        std::atomic<uint64_t> peak_capacity{0};
+        std::atomic<uint64_t> front_slack{0};
+        std::atomic<uint64_t> back_slack{0};
+        std::atomic<growth_hook> hook{nullptr};
+
+        std::mutex sites_lock;
+        std::map<std::string, size_histogram> sites;
+    };
+
+    //never destroyed: vectors with static storage duration may still be
+    //retiring after every other static is gone
+    inline totals& process(void){
+        static totals* t = new totals;
+        return *t;
+    }
+
+    inline void raise_to(std::atomic<uint64_t>& peak, uint64_t v){
+        uint64_t seen = peak.load(std::memory_order_relaxed);
+        while(seen < v && !peak.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {}
+    }
+
+    //charge one growth to an instance and to the process, then call the hook
+    inline void growth(vector_stats& local, const growth_event& e){
+        totals& t = process();
+        switch(e.end){
+            case growth_end::front: local.front_growths++; t.front_growths.fetch_add(1, std::memory_order_relaxed); break;
+            case growth_end::back:  local.back_growths++;  t.back_growths.fetch_add(1, std::memory_order_relaxed); break;
+            default:                local.other_growths++; t.other_growths.fetch_add(1, std::memory_order_relaxed); break;
+        }
+        local.bytes_relocated += e.bytes_relocated;
+        t.bytes_relocated.fetch_add(e.bytes_relocated, std::memory_order_relaxed);
+        if(e.new_capacity > local.peak_capacity) { local.peak_capacity = e.new_capacity; }
+        raise_to(t.peak_capacity, e.new_capacity);
+        growth_hook h = t.hook.load(std::memory_order_acquire);
+        if(h != nullptr) { h(e); }
+    }
+
+    //a vector is going away: record its final size under its site and add
+    //the slack it ended with to the process totals
+    inline void retire(const char* site, uint64_t size, uint64_t capacity, uint64_t front_slack, uint64_t back_slack){
+        totals& t = process();
+        raise_to(t.peak_capacity, capacity);
+        t.front_slack.fetch_add(front_slack, std::memory_order_relaxed);
+        t.back_slack.fetch_add(back_slack, std::memory_order_relaxed);
+        unsigned bucket = (size == 0) ? 0 : 64 - __builtin_clzll(size);
+        std::lock_guard<std::mutex> lock(t.sites_lock);
+        size_histogram& h = t.sites[site ? site : "(unnamed)"];
+        h[bucket]++;
+    }
+
+} //namespace stats_detail
+
+    //Totals over every vector in the process. Slack is counted when a
+    //vector is destroyed, so front_slack and back_slack are the capacity
+    //that vectors still held unused at the end of their lives.
+    inline vector_stats process_vector_stats(void){
+        stats_detail::totals& t = stats_detail::process();
+        vector_stats s;
+        s.front_growths = t.front_growths.load(std::memory_order_relaxed);
+        s.back_growths = t.back_growths.load(std::memory_order_relaxed);
+        s.other_growths = t.other_growths.load(std::memory_order_relaxed);
+        s.bytes_relocated = t.bytes_relocated.load(std::memory_order_relaxed);
+        s.peak_capacity = t.peak_capacity.load(std::memory_order_relaxed);
+        s.front_slack = t.front_slack.load(std::memory_order_relaxed);
+        s.back_slack = t.back_slack.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    //final sizes of destroyed vectors, per set_stats_site() name
+    inline std::map<std::string, size_histogram> vector_size_histograms(void){
+        stats_detail::totals& t = stats_detail::process();
+        std::lock_guard<std::mutex> lock(t.sites_lock);
+        return t.sites;
+    }
+
+    //Installs a function called on every growth of every vector (from the
+    //thread that grew it) and returns the previous one; nullptr removes it.
+    inline growth_hook set_growth_hook(growth_hook h){
+        return stats_detail::process().hook.exchange(h, std::memory_order_acq_rel);
+    }
+
+    inline void reset_vector_stats(void){
+        stats_detail::totals& t = stats_detail::process();
+        t.front_growths = 0; t.back_growths = 0; t.other_growths = 0;
+        t.bytes_relocated = 0; t.peak_capacity = 0;
+        t.front_slack = 0; t.back_slack = 0;
+        std::lock_guard<std::mutex> lock(t.sites_lock);
+        t.sites.clear();
+    }
+
+} //namespace epl
+
+#endif
@@ -0,0 +1,534 @@
+#ifndef _VIEW_H_
+#define _VIEW_H_
+
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+//Lazy views: epl::view(v).filter(p).transform(f).take(n).collect() builds
+//no vector until collect(), and then makes a single pass over v. Each view
+//is a small object wrapping the one before it; running the outermost one
+//hands every element down through all of their functions in one loop,
+//which the compiler inlines into a single loop body. A view of an
+//epl::vector reads its storage through a plain pointer, so it must not
+//outlive the vector or a change to the vector's length.
+//
+//A view is run in one of two ways: run(sink) pushes the elements into
+//sink until sink returns false, and start() returns a cursor whose
+//step(sink) pulls one element at a time, which zip uses for its second
+//view. Views whose length is known without running them (sized) let
+//collect() reserve the whole result up front.
+
+namespace epl{
+inline namespace EPL_ITERATOR_NAMESPACE{
+
+    template <typename T> class span_view;
+    template <typename IT> class range_view;
+    template <typename S, typename P> class filter_view;
+    template <typename S, typename F> class transform_view;
+    template <typename S> class take_view;
+    template <typename S> class drop_view;
+    template <typename S> class enumerate_view;
+    template <typename A, typename B> class zip_view;
+    template <typename S> class chunk_view;
+
+namespace view_detail{
+
+    template <typename V, typename Out>
+    void presize(const V& v, Out& out, std::true_type) { out.reserve(out.size() + v.size()); }
+
+    template <typename V, typename Out>
+    void presize(const V&, Out&, std::false_type) {}
+
+} //namespace view_detail
+
+    //The operations every view has. Each one returns a new view and leaves
+    //this one unchanged; function objects are copied into the new view.
+    template <typename D>
+    class view_base{
+    private:
+        const D& self(void) const { return static_cast<const D&>(*this); }
+
+    public:
+        //the elements x for which p(x) is true
+        template <typename P>
+        filter_view<D, P> filter(P p) const { return filter_view<D, P>(self(), std::move(p)); }
+
+        //f(x) for each element x
+        template <typename F>
+        transform_view<D, F> transform(F f) const { return transform_view<D, F>(self(), std::move(f)); }
+
+        //the first n elements, or all of them if there are fewer
+        take_view<D> take(uint64_t n) const { return take_view<D>(self(), n); }
+
+        //all but the first n elements
+        drop_view<D> drop(uint64_t n) const { return drop_view<D>(self(), n); }
+
+        //std::pair(i, x) for the i-th element x, counting from 0
+        enumerate_view<D> enumerate(void) const { return enumerate_view<D>(self()); }
+
+        //std::pair(x, y) of the i-th elements of this view and of that one,
+        //for as long as both have elements
+        template <typename V>
+        zip_view<D, V> zip(const V& that) const { return zip_view<D, V>(self(), that); }
+
+        //the elements in epl::vectors of n, the last one possibly shorter;
+        //each vector is passed by const reference and reused for the next
+        chunk_view<D> chunk(uint64_t n) const{
+            if(n == 0) { throw std::out_of_range{"chunk size must not be 0"}; }
+            return chunk_view<D>(self(), n);
+        }
+
+        //calls f(x) on every element
+        template <typename F>
+        void for_each(F f) const{
+            self().run([&f](auto&& x) { f(std::forward<decltype(x)>(x)); return true; });
+        }
+
+        //appends every element to out, reserving room first when the view
+        //is sized
+        template <typename T, typename A, typename G>
+        void collect_into(vector<T, A, G>& out) const{
+            view_detail::presize(self(), out, std::integral_constant<bool, D::sized>());
+            self().run([&out](auto&& x) { out.emplace_back(std::forward<decltype(x)>(x)); return true; });
+        }
+
+        //the elements in a new epl::vector
+        auto collect(void) const{
+            vector<typename D::value_type> out;
+            collect_into(out);
+            return out;
+        }
+    };
+
+    /**********************sources*********************************/
+    //the elements of a contiguous array; take and drop stay spans
+    template <typename T>
+    class span_view : public view_base<span_view<T> >{
+    private:
+        const T* first;
+        uint64_t length;
+
+    public:
+        typedef T value_type;
+        typedef const T& reference;
+        static constexpr bool sized = true;
+
+        span_view(const T* first, uint64_t length) { this->first = first; this->length = length; }
+
+        uint64_t size(void) const { return length; }
+        const T* data(void) const { return first; }
+
+        span_view take(uint64_t n) const { return span_view(first, (n < length) ? n : length); }
+        span_view drop(uint64_t n) const { return (n < length) ? span_view(first + n, length - n) : span_view(first + length, 0); }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            for(uint64_t k = 0; k < length; k++){
+                if(!sink(first[k])) { return false; }
+            }
+            return true;
+        }
+
+        class cursor{
+        private:
+            const T* p;
+            const T* last;
+
+        public:
+            cursor(const T* p, const T* last) { this->p = p; this->last = last; }
+
+            template <typename Sink>
+            bool step(Sink&& sink){
+                if(p == last) { return false; }
+                sink(*p++);
+                return true;
+            }
+        };
+
+        cursor start(void) const { return cursor(first, first + length); }
+    };
+
+    //the elements of [first, last); sized if IT is random access
+    template <typename IT>
+    class range_view : public view_base<range_view<IT> >{
+    private:
+        IT first;
+        IT last;
+
+    public:
+        typedef typename std::decay<typename std::iterator_traits<IT>::value_type>::type value_type;
+        typedef typename std::iterator_traits<IT>::reference reference;
+        static constexpr bool sized = std::is_base_of<std::random_access_iterator_tag,
+                                                      typename std::iterator_traits<IT>::iterator_category>::value;
+
+        range_view(IT first, IT last) : first(first), last(last) {}
+
+        uint64_t size(void) const { return last - first; }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            for(IT it = first; it != last; ++it){
+                if(!sink(*it)) { return false; }
+            }
+            return true;
+        }
+
+        class cursor{
+        private:
+            IT p;
+            IT last;
+
+        public:
+            cursor(IT p, IT last) : p(p), last(last) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink){
+                if(p == last) { return false; }
+                sink(*p);
+                ++p;
+                return true;
+            }
+        };
+
+        cursor start(void) const { return cursor(first, last); }
+    };
+
+    template <typename T, typename A, typename G>
+    span_view<T> view(const vector<T, A, G>& v) { return span_view<T>(v.data(), v.size()); }
+
+    template <typename T>
+    span_view<T> view(const T* first, uint64_t n) { return span_view<T>(first, n); }
+
+    template <typename IT>
+    range_view<IT> view(IT first, IT last) { return range_view<IT>(first, last); }
+
+    //any other container, through its const iterators
+    template <typename C>
+    range_view<typename C::const_iterator> view(const C& c) { return range_view<typename C::const_iterator>(c.begin(), c.end()); }
+
+    /**********************adaptors*********************************/
+    template <typename S, typename P>
+    class filter_view : public view_base<filter_view<S, P> >{
+    private:
+        S source;
+        P pred;
+
+    public:
+        typedef typename S::value_type value_type;
+        typedef typename S::reference reference;
+        static constexpr bool sized = false;
+
+        filter_view(const S& source, P pred) : source(source), pred(std::move(pred)) {}
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            return source.run([this, &sink](auto&& x) -> bool {
+                if(!pred(x)) { return true; }
+                return sink(std::forward<decltype(x)>(x));
+            });
+        }
+
+        class cursor{
+        private:
+            typename S::cursor from;
+            const P* pred;
+
+        public:
+            cursor(const typename S::cursor& c, const P* p) : from(c), pred(p) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink){
+                bool hit = false;
+                while(!hit){
+                    bool more = from.step([this, &sink, &hit](auto&& x) {
+                        if((*pred)(x)){
+                            hit = true;
+                            sink(std::forward<decltype(x)>(x));
+                        }
+                    });
+                    if(!more) { return false; }
+                }
+                return true;
+            }
+        };
+
+        cursor start(void) const { return cursor(source.start(), &pred); }
+    };
+
+    template <typename S, typename F>
+    class transform_view : public view_base<transform_view<S, F> >{
+    private:
+        S source;
+        F f;
+
+    public:
+        typedef decltype(std::declval<const F&>()(std::declval<typename S::reference>())) reference;
+        typedef typename std::decay<reference>::type value_type;
+        static constexpr bool sized = S::sized;
+
+        transform_view(const S& source, F f) : source(source), f(std::move(f)) {}
+
+        uint64_t size(void) const { return source.size(); }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            return source.run([this, &sink](auto&& x) -> bool { return sink(f(std::forward<decltype(x)>(x))); });
+        }
+
+        class cursor{
+        private:
+            typename S::cursor from;
+            const F* f;
+
+        public:
+            cursor(const typename S::cursor& c, const F* f) : from(c), f(f) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink) { return from.step([this, &sink](auto&& x) { sink((*f)(std::forward<decltype(x)>(x))); }); }
+        };
+
+        cursor start(void) const { return cursor(source.start(), &f); }
+    };
+
+    template <typename S>
+    class take_view : public view_base<take_view<S> >{
+    private:
+        S source;
+        uint64_t n;
+
+    public:
+        typedef typename S::value_type value_type;
+        typedef typename S::reference reference;
+        static constexpr bool sized = S::sized;
+
+        take_view(const S& source, uint64_t n) : source(source), n(n) {}
+
+        uint64_t size(void) const { return (n < source.size()) ? n : source.size(); }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            if(n == 0) { return true; }
+            uint64_t left = n;
+            bool stopped = false;
+            source.run([&sink, &left, &stopped](auto&& x) -> bool {
+                if(!sink(std::forward<decltype(x)>(x))) { stopped = true; return false; }
+                return --left != 0;
+            });
+            return !stopped;
+        }
+
+        class cursor{
+        private:
+            typename S::cursor from;
+            uint64_t left;
+
+        public:
+            cursor(const typename S::cursor& c, uint64_t left) : from(c), left(left) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink){
+                if(left == 0) { return false; }
+                left--;
+                return from.step(std::forward<Sink>(sink));
+            }
+        };
+
+        cursor start(void) const { return cursor(source.start(), n); }
+    };
+
+    template <typename S>
+    class drop_view : public view_base<drop_view<S> >{
+    private:
+        S source;
+        uint64_t n;
+
+    public:
+        typedef typename S::value_type value_type;
+        typedef typename S::reference reference;
+        static constexpr bool sized = S::sized;
+
+        drop_view(const S& source, uint64_t n) : source(source), n(n) {}
+
+        uint64_t size(void) const { return (n < source.size()) ? source.size() - n : 0; }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            uint64_t skip = n;
+            return source.run([&sink, &skip](auto&& x) -> bool {
+                if(skip != 0) { skip--; return true; }
+                return sink(std::forward<decltype(x)>(x));
+            });
+        }
+
+        class cursor{
+        private:
+            typename S::cursor from;
+            uint64_t skip;
+
+        public:
+            cursor(const typename S::cursor& c, uint64_t skip) : from(c), skip(skip) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink){
+                for(; skip != 0; skip--){
+                    if(!from.step([](auto&&) {})) { return false; }
+                }
+                return from.step(std::forward<Sink>(sink));
+            }
+        };
+
+        cursor start(void) const { return cursor(source.start(), n); }
+    };
+
+    template <typename S>
+    class enumerate_view : public view_base<enumerate_view<S> >{
+    private:
+        S source;
+
+    public:
+        typedef std::pair<uint64_t, typename S::value_type> value_type;
+        typedef std::pair<uint64_t, typename S::reference> reference;
+        static constexpr bool sized = S::sized;
+
+        explicit enumerate_view(const S& source) : source(source) {}
+
+        uint64_t size(void) const { return source.size(); }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            uint64_t i = 0;
+            return source.run([&sink, &i](auto&& x) -> bool { return sink(reference(i++, std::forward<decltype(x)>(x))); });
+        }
+
+        class cursor{
+        private:
+            typename S::cursor from;
+            uint64_t i;
+
+        public:
+            explicit cursor(const typename S::cursor& c) : from(c), i(0) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink) { return from.step([this, &sink](auto&& x) { sink(reference(i++, std::forward<decltype(x)>(x))); }); }
+        };
+
+        cursor start(void) const { return cursor(source.start()); }
+    };
+
+    //runs the first view and pulls the second one along with a cursor
+    template <typename A, typename B>
+    class zip_view : public view_base<zip_view<A, B> >{
+    private:
+        A first;
+        B second;
+
+    public:
+        typedef std::pair<typename A::value_type, typename B::value_type> value_type;
+        typedef std::pair<typename A::reference, typename B::reference> reference;
+        static constexpr bool sized = A::sized && B::sized;
+
+        zip_view(const A& first, const B& second) : first(first), second(second) {}
+
+        uint64_t size(void) const { return (first.size() < second.size()) ? first.size() : second.size(); }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            typename B::cursor other = second.start();
+            bool stopped = false;
+            first.run([&sink, &other, &stopped](auto&& x) -> bool {
+                bool more = true;
+                bool paired = other.step([&sink, &x, &more](auto&& y) {
+                    more = sink(reference(std::forward<decltype(x)>(x), std::forward<decltype(y)>(y)));
+                });
+                if(paired && !more) { stopped = true; }
+                return paired && more;
+            });
+            return !stopped;
+        }
+
+        class cursor{
+        private:
+            typename A::cursor a;
+            typename B::cursor b;
+
+        public:
+            cursor(const typename A::cursor& a, const typename B::cursor& b) : a(a), b(b) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink){
+                bool paired = false;
+                a.step([this, &sink, &paired](auto&& x) {
+                    paired = b.step([&sink, &x](auto&& y) {
+                        sink(reference(std::forward<decltype(x)>(x), std::forward<decltype(y)>(y)));
+                    });
+                });
+                return paired;
+            }
+        };
+
+        cursor start(void) const { return cursor(first.start(), second.start()); }
+    };
+
+    template <typename S>
+    class chunk_view : public view_base<chunk_view<S> >{
+    private:
+        S source;
+        uint64_t n;
+
+    public:
+        typedef vector<typename S::value_type> value_type;
+        typedef const value_type& reference;
+        static constexpr bool sized = S::sized;
+
+        chunk_view(const S& source, uint64_t n) : source(source), n(n) {}
+
+        uint64_t size(void) const { return (source.size() + n - 1) / n; }
+
+        template <typename Sink>
+        bool run(Sink&& sink) const{
+            value_type buffer;
+            buffer.reserve(n);
+            uint64_t k = n;
+            bool stopped = false;
+            source.run([&sink, &buffer, &stopped, k](auto&& x) -> bool {
+                buffer.emplace_back(std::forward<decltype(x)>(x));
+                if(buffer.size() < k) { return true; }
+                stopped = !sink(static_cast<reference>(buffer));
+                buffer.clear();
+                return !stopped;
+            });
+            if(stopped) { return false; }
+            return buffer.empty() || sink(static_cast<reference>(buffer));
+        }
+
+        class cursor{
+        private:
+            typename S::cursor from;
+            uint64_t n;
+            value_type buffer;
+
+        public:
+            cursor(const typename S::cursor& c, uint64_t n) : from(c), n(n) {}
+
+            template <typename Sink>
+            bool step(Sink&& sink){
+                buffer.clear();
+                while(buffer.size() < n && from.step([this](auto&& x) { buffer.emplace_back(std::forward<decltype(x)>(x)); })) {}
+                if(buffer.empty()) { return false; }
+                sink(static_cast<reference>(buffer));
+                return true;
+            }
+        };
+
+        cursor start(void) const { return cursor(source.start(), n); }
+    };
+
+} //namespace EPL_ITERATOR_NAMESPACE
+} //namespace epl
+
+#endif
@@ -0,0 +1,526 @@
+//Benchmarks epl::vector against std::vector and std::deque, the SIMD
+//kernels against plain loops, concurrent_vector against a locked vector,
+//and the parallel algorithms across thread counts.
+//
+//  g++ -std=c++14 -O2 -I. bench/bench.cpp -o vector_bench -pthread
+//  ./vector_bench [elements] > results.csv
+//
+//Every row is one operation on one element type in one container:
+//  op,type,container,n,ns_per_op,allocations,regrowths,peak_rss_kb,checked
+//ns_per_op is the best of three runs. allocations counts allocate and
+//reallocate calls made during the run. regrowths counts the blocks that
+//replaced a smaller one, whether by copying or in place; a deque's
+//chunks are allocations but not regrowths. peak_rss_kb is the resident
+//high-water mark of the run (Linux; elsewhere the process maximum).
+//checked is EPL_CHECKED_ITERATORS, which is on unless NDEBUG is defined.
+//An epl::vector queue of 1000 elements is checked to stay in 2048 slots
+//before the rows are timed; a failure is reported on stderr and ends the
+//run with status 1. The SIMD kernels' results are checked by
+//tests/simd_test.cpp, not here.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "../Vector.h"
+#include "../ConcurrentVector.h"
+#include "../SoaVector.h"
+#include "../Parallel.h"
+#include "../Simd.h"
+
+namespace{
+
+    /*********************allocation counting*******************************/
+    uint64_t allocations = 0;
+    uint64_t regrowths = 0;
+
+    //epl::allocator with every call counted; all three containers use it,
+    //so they draw memory from the same place. A regrowth is a block that
+    //replaces a smaller one: a reallocate, or an allocate whose next
+    //deallocate of the same element type frees a smaller block. Blocks of
+    //one size coming and going (a deque's chunks) are not regrowths.
+    template <typename T>
+    struct counted : epl::allocator<T>{
+        typedef T value_type;
+        template <typename U> struct rebind { typedef counted<U> other; };
+
+        static std::size_t& pending(void) { static std::size_t n = 0; return n; }    //size of the last allocate
+
+        counted(void) {}
+        template <typename U> counted(const counted<U>&) {}
+
+        T* allocate(std::size_t n){
+            allocations++;
+            T* p = epl::allocator<T>::allocate(n);
+            pending() = n;
+            return p;
+        }
+
+        void deallocate(T* p, std::size_t n){
+            if(n < pending()) { regrowths++; }
+            pending() = 0;
+            epl::allocator<T>::deallocate(p, n);
+        }
+
+        T* reallocate(T* p, std::size_t old_n, std::size_t new_n){
+            allocations++;
+            regrowths++;
+            return epl::allocator<T>::reallocate(p, old_n, new_n);
+        }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const counted<T>&, const counted<U>&) { return true; }
+    template <typename T, typename U>
+    bool operator!=(const counted<T>&, const counted<U>&) { return false; }
+
+    /*********************peak resident set********************************/
+    //Linux resets the high-water mark on a write of "5" to clear_refs
+    void reset_peak_rss(void){
+        std::FILE* f = std::fopen("/proc/self/clear_refs", "w");
+        if(f != nullptr) { std::fputs("5", f); std::fclose(f); }
+    }
+
+    long peak_rss_kb(void){
+        std::FILE* f = std::fopen("/proc/self/status", "r");
+        if(f != nullptr){
+            char line[256];
+            long kb = -1;
+            while(std::fgets(line, sizeof(line), f) != nullptr){
+                if(std::strncmp(line, "VmHWM:", 6) == 0) { kb = std::atol(line + 6); break; }
+            }
+            std::fclose(f);
+            if(kb >= 0) { return kb; }
+        }
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        return ru.ru_maxrss;
+    }
+
+    /*********************element types************************************/
+    struct pod64{
+        int64_t key;
+        int64_t pad[7];
+    };
+
+    typedef std::unique_ptr<int64_t> move_only;
+
+    template <typename T> struct element;
+
+    template <> struct element<int>{
+        static const char* name(void) { return "int"; }
+        static int make(uint64_t i) { return int(i); }
+        static int64_t weigh(const int& x) { return x; }
+    };
+
+    template <> struct element<pod64>{
+        static const char* name(void) { return "pod64"; }
+        static pod64 make(uint64_t i) { pod64 p; p.key = i; for(int k = 0; k < 7; k++) { p.pad[k] = i + k; } return p; }
+        static int64_t weigh(const pod64& x) { return x.key; }
+    };
+
+    template <> struct element<std::string>{
+        static const char* name(void) { return "string"; }
+        //long enough to live on the heap, past any small-string buffer
+        static std::string make(uint64_t i) { return std::string(32, char('a' + i % 26)); }
+        static int64_t weigh(const std::string& x) { return x[0]; }
+    };
+
+    template <> struct element<move_only>{
+        static const char* name(void) { return "move_only"; }
+        static move_only make(uint64_t i) { return move_only(new int64_t(i)); }
+        static int64_t weigh(const move_only& x) { return *x; }
+    };
+
+    /*********************containers***************************************/
+    template <typename T> using epl_vector = epl::vector<T, counted<T> >;
+    template <typename T> using std_vector = std::vector<T, counted<T> >;
+    template <typename T> using std_deque = std::deque<T, counted<T> >;
+
+    template <typename C> struct container_name;
+    template <typename T> struct container_name<epl_vector<T> > { static const char* get(void) { return "epl::vector"; } };
+    template <typename T> struct container_name<std_vector<T> > { static const char* get(void) { return "std::vector"; } };
+    template <typename T> struct container_name<std_deque<T> > { static const char* get(void) { return "std::deque"; } };
+
+    //results of the runs are folded in here so the optimizer keeps them
+    volatile int64_t sink;
+
+    /*********************measurement**************************************/
+    //runs body(n) three times and prints the best time as ns per element
+    template <typename F>
+    void measure(const char* op, const char* type, const char* container, uint64_t n, F body){
+        double best = 0;
+        uint64_t allocs = 0, regrows = 0;
+        long rss = 0;
+        for(int run = 0; run < 3; run++){
+            reset_peak_rss();
+            allocations = 0;
+            regrowths = 0;
+            auto start = std::chrono::steady_clock::now();
+            body(n);
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if(run == 0 || ns < best) { best = ns; }
+            allocs = allocations;
+            regrows = regrowths;
+            rss = peak_rss_kb();
+        }
+        std::printf("%s,%s,%s,%llu,%.3f,%llu,%llu,%ld,%d\n", op, type, container, (unsigned long long) n,
+                    best / n, (unsigned long long) allocs, (unsigned long long) regrows, rss, EPL_CHECKED_ITERATORS);
+        std::fflush(stdout);
+    }
+
+    template <typename C>
+    C filled(uint64_t n){
+        typedef typename C::value_type T;
+        C c;
+        for(uint64_t i = 0; i < n; i++) { c.push_back(element<T>::make(i)); }
+        return c;
+    }
+
+    //the loop the iterators are measured against: a walk over data() with a
+    //plain pointer, for the containers that store their elements in one block
+    template <typename C>
+    void iterate_raw(const C& source, const char* type, const char* name, uint64_t n){
+        typedef typename C::value_type T;
+        measure("iterate_raw", type, name, n, [&source](uint64_t n){
+            int64_t total = 0;
+            for(const T* p = source.data(), * e = p + n; p != e; ++p) { total += element<T>::weigh(*p); }
+            sink = sink + total;
+        });
+    }
+
+    template <typename T>
+    void iterate_raw(const std_deque<T>&, const char*, const char*, uint64_t) {}
+
+    //operations every container has
+    template <typename C>
+    void common_ops(uint64_t n){
+        typedef typename C::value_type T;
+        const char* type = element<T>::name();
+        const char* name = container_name<C>::get();
+
+        measure("push_back", type, name, n, [](uint64_t n){
+            C c;
+            for(uint64_t i = 0; i < n; i++) { c.push_back(element<T>::make(i)); }
+            sink = sink + c.size();
+        });
+
+        C source = filled<C>(n);
+
+        measure("iterate_iterator", type, name, n, [&source](uint64_t){
+            int64_t total = 0;
+            for(auto it = source.begin(); it != source.end(); ++it) { total += element<T>::weigh(*it); }
+            sink = sink + total;
+        });
+
+        measure("iterate_index", type, name, n, [&source](uint64_t n){
+            int64_t total = 0;
+            for(uint64_t i = 0; i < n; i++) { total += element<T>::weigh(source[i]); }
+            sink = sink + total;
+        });
+
+        iterate_raw(static_cast<const C&>(source), type, name, n);
+
+        measure("move_construct", type, name, n, [&source](uint64_t){
+            C moved(std::move(source));
+            sink = sink + moved.size();
+            source = std::move(moved);
+        });
+
+        std::vector<T> plain;
+        for(uint64_t i = 0; i < n; i++) { plain.push_back(element<T>::make(i)); }
+        measure("range_construct", type, name, n, [&plain](uint64_t){
+            C c(std::make_move_iterator(plain.begin()), std::make_move_iterator(plain.end()));
+            sink = sink + c.size();
+            for(uint64_t i = 0; i < c.size(); i++) { plain[i] = std::move(c[i]); }
+        });
+    }
+
+    template <typename C>
+    void copy_op(uint64_t n){
+        typedef typename C::value_type T;
+        C source = filled<C>(n);
+        measure("copy_construct", element<T>::name(), container_name<C>::get(), n, [&source](uint64_t){
+            C copy(source);
+            sink = sink + copy.size();
+        });
+    }
+
+    //operations at the front, which std::vector lacks
+    template <typename C>
+    void front_ops(uint64_t n){
+        typedef typename C::value_type T;
+        const char* type = element<T>::name();
+        const char* name = container_name<C>::get();
+
+        measure("push_front", type, name, n, [](uint64_t n){
+            C c;
+            for(uint64_t i = 0; i < n; i++) { c.push_front(element<T>::make(i)); }
+            sink = sink + c.size();
+        });
+
+        measure("push_mixed", type, name, n, [](uint64_t n){
+            C c;
+            for(uint64_t i = 0; i < n; i++){
+                if(i & 1) { c.push_front(element<T>::make(i)); }
+                else { c.push_back(element<T>::make(i)); }
+            }
+            sink = sink + c.size();
+        });
+
+        //a queue that holds about a thousand elements
+        measure("fifo", type, name, n, [](uint64_t n){
+            C c;
+            for(uint64_t i = 0; i < 1024; i++) { c.push_back(element<T>::make(i)); }
+            for(uint64_t i = 0; i < n; i++){
+                c.push_back(element<T>::make(i));
+                c.pop_front();
+            }
+            sink = sink + c.size();
+        });
+    }
+
+    //an epl::vector used as a queue of 1000 elements must settle in 2048
+    //slots: once it has made room, a million push_back/pop_front pairs
+    //neither grow it nor allocate
+    template <typename T>
+    void fifo_bound(void){
+        epl_vector<T> c;
+        for(uint64_t i = 0; i < 1000; i++) { c.push_back(element<T>::make(i)); }
+        uint64_t settled = 0, most = c.capacity();
+        for(uint64_t i = 0; i < 1000000; i++){
+            c.push_back(element<T>::make(i));
+            c.pop_front();
+            if(c.capacity() > most) { most = c.capacity(); }
+            if(i == 2048) { settled = allocations; }
+        }
+        if(most > 2048 || allocations != settled){
+            std::fprintf(stderr, "fifo on %s grew to %llu slots with %llu allocations after settling\n",
+                         element<T>::name(), (unsigned long long) most, (unsigned long long) (allocations - settled));
+            std::exit(1);
+        }
+    }
+
+    template <typename T>
+    void all_ops(uint64_t n){
+        fifo_bound<T>();
+        common_ops<epl_vector<T> >(n);
+        common_ops<std_vector<T> >(n);
+        common_ops<std_deque<T> >(n);
+        front_ops<epl_vector<T> >(n);
+        front_ops<std_deque<T> >(n);
+    }
+
+    template <typename T>
+    void copy_ops(uint64_t n){
+        copy_op<epl_vector<T> >(n);
+        copy_op<std_vector<T> >(n);
+        copy_op<std_deque<T> >(n);
+    }
+
+    /*********************columns against records***************************/
+    //a pass over one field of a wide record: whole records (AoS) drag the
+    //other 56 bytes through the cache, a soa_vector column does not
+    struct record{
+        double price;
+        double quantity;
+        int64_t id;
+        int64_t timestamp;
+        char tag[32];
+    };
+
+    void field_scan(uint64_t n){
+        epl::vector<record> aos;
+        epl::soa_vector<double, double, int64_t, int64_t> soa;
+        for(uint64_t i = 0; i < n; i++){
+            record r;
+            std::memset(&r, 0, sizeof(r));
+            r.price = i * 0.5;
+            r.quantity = 1;
+            r.id = i;
+            r.timestamp = i;
+            aos.push_back(r);
+            soa.push_back(r.price, r.quantity, r.id, r.timestamp);
+        }
+
+        measure("field_scan", "record", "epl::vector", n, [&aos](uint64_t n){
+            double total = 0;
+            const record* p = aos.data();
+            for(uint64_t i = 0; i < n; i++) { total += p[i].price; }
+            sink = sink + int64_t(total);
+        });
+
+        measure("field_scan", "record", "epl::soa_vector", n, [&soa](uint64_t){
+            double total = 0;
+            auto prices = soa.column<0>();
+            for(double x : prices) { total += x; }
+            sink = sink + int64_t(total);
+        });
+    }
+
+    /*********************simd kernels************************************/
+    template <typename T> struct simd_type;
+    template <> struct simd_type<int32_t> { static const char* name(void) { return "int32"; } };
+    template <> struct simd_type<int64_t> { static const char* name(void) { return "int64"; } };
+    template <> struct simd_type<float> { static const char* name(void) { return "float"; } };
+    template <> struct simd_type<double> { static const char* name(void) { return "double"; } };
+
+    //sum, minmax, find and dot at every level the CPU runs, after a plain
+    //loop over the same data; the container column names the level
+    template <typename T>
+    void simd_kernels(uint64_t n){
+        typedef typename epl::simd::detail::arith_of<T>::type U;
+        const char* type = simd_type<T>::name();
+        epl::vector<T> a, b;
+        for(uint64_t i = 0; i < n; i++){
+            a.push_back(T(int64_t(i * 2654435761u % 2001) - 1000));
+            b.push_back(T(int64_t(i % 7) - 3));
+        }
+        const T* pa = static_cast<const epl::vector<T>&>(a).data();
+        const T* pb = static_cast<const epl::vector<T>&>(b).data();
+        const T missing = T(5000);
+
+        measure("simd_sum", type, "loop", n, [pa](uint64_t n){
+            U t = 0;
+            for(uint64_t i = 0; i < n; i++) { t += U(pa[i]); }
+            sink = sink + int64_t(t);
+        });
+        measure("simd_minmax", type, "loop", n, [pa](uint64_t n){
+            T l = pa[0], h = pa[0];
+            for(uint64_t i = 0; i < n; i++) { l = (pa[i] < l) ? pa[i] : l; h = (pa[i] > h) ? pa[i] : h; }
+            sink = sink + int64_t(l) + int64_t(h);
+        });
+        measure("simd_find", type, "loop", n, [pa, missing](uint64_t n){
+            uint64_t i = 0;
+            while(i < n && pa[i] != missing) { i++; }
+            sink = sink + int64_t(i);
+        });
+        measure("simd_dot", type, "loop", n, [pa, pb](uint64_t n){
+            U t = 0;
+            for(uint64_t i = 0; i < n; i++) { t += U(pa[i]) * U(pb[i]); }
+            sink = sink + int64_t(t);
+        });
+
+        for(int l = epl::simd::SCALAR; l <= epl::simd::detected(); l++){
+            epl::simd::level level = epl::simd::level(l);
+            const char* name = epl::simd::level_name(level);
+            measure("simd_sum", type, name, n, [pa, level](uint64_t n){
+                sink = sink + int64_t(epl::simd::sum(pa, n, level));
+            });
+            measure("simd_minmax", type, name, n, [pa, level](uint64_t n){
+                std::pair<T, T> m = epl::simd::minmax(pa, n, level);
+                sink = sink + int64_t(m.first) + int64_t(m.second);
+            });
+            measure("simd_find", type, name, n, [pa, missing, level](uint64_t n){
+                sink = sink + int64_t(epl::simd::find(pa, n, missing, level));
+            });
+            measure("simd_dot", type, name, n, [pa, pb, level](uint64_t n){
+                sink = sink + int64_t(epl::simd::dot(pa, pb, n, level));
+            });
+        }
+    }
+
+    /*********************concurrent appends*******************************/
+    //n push_backs split over 1, 2, 4, ... 64 threads, into a
+    //concurrent_vector and into an epl::vector behind a mutex
+    template <typename F>
+    void on_threads(unsigned threads, uint64_t n, F body){
+        std::vector<std::thread> pool;
+        for(unsigned t = 0; t < threads; t++){
+            uint64_t first = n * t / threads, last = n * (t + 1) / threads;
+            pool.emplace_back([first, last, &body]{ body(first, last); });
+        }
+        for(auto& th : pool) { th.join(); }
+    }
+
+    void concurrent_appends(uint64_t n){
+        for(unsigned threads = 1; threads <= 64; threads *= 2){
+            char name[64];
+            std::snprintf(name, sizeof(name), "epl::concurrent_vector(%u)", threads);
+            measure("concurrent_push_back", "int64", name, n, [threads](uint64_t n){
+                epl::concurrent_vector<int64_t> c;
+                on_threads(threads, n, [&c](uint64_t first, uint64_t last){
+                    for(uint64_t i = first; i < last; i++) { c.push_back(int64_t(i)); }
+                });
+                sink = sink + c.size();
+            });
+
+            std::snprintf(name, sizeof(name), "mutex+epl::vector(%u)", threads);
+            measure("concurrent_push_back", "int64", name, n, [threads](uint64_t n){
+                epl::vector<int64_t> v;
+                std::mutex m;
+                on_threads(threads, n, [&v, &m](uint64_t first, uint64_t last){
+                    for(uint64_t i = first; i < last; i++){
+                        std::lock_guard<std::mutex> hold(m);
+                        v.push_back(int64_t(i));
+                    }
+                });
+                sink = sink + v.size();
+            });
+        }
+    }
+
+    /*********************parallel scaling********************************/
+    //the same reduce and sort on pools of 1, 2, 4, ... threads up to the
+    //hardware's count; the container column names the pool size
+    void parallel_scaling(uint64_t n){
+        epl::vector<int64_t> data;
+        for(uint64_t i = 0; i < n; i++) { data.push_back(int64_t(i * 2654435761u % 1000003)); }
+        unsigned most = std::thread::hardware_concurrency();
+        if(most == 0) { most = 1; }
+        for(unsigned threads = 1; ; threads *= 2){
+            if(threads > most) { threads = most; }
+            epl::thread_pool pool(threads);
+            char name[48];
+            std::snprintf(name, sizeof(name), "epl::thread_pool(%u)", threads);
+
+            measure("parallel_reduce", "int64", name, n, [&data, &pool](uint64_t){
+                sink = sink + epl::parallel_reduce(data, int64_t(0), std::plus<int64_t>(), pool);
+            });
+
+            measure("parallel_sort", "int64", name, n, [&data, &pool](uint64_t){
+                epl::vector<int64_t> copy(data);
+                epl::parallel_sort(copy, pool);
+                sink = sink + copy[0];
+            });
+
+            if(threads == most) { break; }
+        }
+    }
+
+} //namespace
+
+int main(int argc, char** argv){
+    uint64_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::printf("op,type,container,n,ns_per_op,allocations,regrowths,peak_rss_kb,checked\n");
+
+    all_ops<int>(n);
+    all_ops<pod64>(n);
+    all_ops<std::string>(n);
+    all_ops<move_only>(n);
+
+    copy_ops<int>(n);
+    copy_ops<pod64>(n);
+    copy_ops<std::string>(n);
+
+    field_scan(n);
+    simd_kernels<int32_t>(n);
+    simd_kernels<int64_t>(n);
+    simd_kernels<float>(n);
+    simd_kernels<double>(n);
+    concurrent_appends(n);
+    parallel_scaling(n);
+    return 0;
+}
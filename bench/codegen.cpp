@@ -0,0 +1,25 @@
+//The loops bench/codegen.sh compares: with NDEBUG, a range-for over an
+//epl::vector and an iterator loop over a const one must compile to the
+//same loop as sum_raw's walk over raw pointers.
+
+#include <cstdint>
+
+#include "../Vector.h"
+
+int64_t sum_range(epl::vector<int>& v){
+    int64_t total = 0;
+    for(int x : v) { total += x; }
+    return total;
+}
+
+int64_t sum_iterator(const epl::vector<int>& v){
+    int64_t total = 0;
+    for(auto it = v.begin(); it != v.end(); ++it) { total += *it; }
+    return total;
+}
+
+int64_t sum_raw(const int* b, const int* e){
+    int64_t total = 0;
+    for(const int* p = b; p != e; ++p) { total += *p; }
+    return total;
+}
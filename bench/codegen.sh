@@ -0,0 +1,64 @@
+#!/bin/sh
+#Compiles bench/codegen.cpp with NDEBUG and checks that the loops of
+#sum_range and sum_iterator are instruction for instruction the loop of
+#sum_raw, up to register names. Run from the repository root:
+#
+#  sh bench/codegen.sh [extra compiler flags]
+#
+#CXX picks the compiler (g++ by default). Exits 1 if the loops differ.
+
+asm=$(${CXX:-g++} -std=c++14 -O2 -DNDEBUG -I. "$@" -S bench/codegen.cpp -o -) || exit 1
+
+#the instructions from a loop's label to the jump back to it, with
+#registers renamed in order of appearance, labels dropped and the two
+#registers of a compare sorted (the loops only test it for equality)
+loop(){
+    printf '%s\n' "$asm" | awk -v fn="$1" '
+        $0 ~ "^_Z[0-9]+" fn "[^:]*:$" { found = 1; next }
+        !found { next }
+        /\.cfi_endproc/ { exit }
+        /^\.L[A-Za-z0-9_]+:$/ { at[substr($1, 1, length($1) - 1)] = n; next }
+        /^\t[a-z]/ {
+            line[++n] = $0
+            if($1 ~ /^j/ && ($2 in at)){
+                for(k = at[$2] + 1; k <= n; k++) { print line[k] }
+                exit
+            }
+        }' | awk '{
+            out = ""; s = $0
+            while(match(s, /%[a-z0-9]+/)){
+                r = substr(s, RSTART, RLENGTH)
+                if(!(r in name)) { name[r] = "%r" (++regs) }
+                out = out substr(s, 1, RSTART - 1) name[r]
+                s = substr(s, RSTART + RLENGTH)
+            }
+            sub(/\.L[A-Za-z0-9_]+/, "L", s)
+            out = out s
+            if(split(out, f, /[ \t,]+/) == 4 && f[2] ~ /^cmp/ && f[3] ~ /^%r/ && f[4] ~ /^%r/ && f[3] > f[4]){
+                out = "\t" f[2] "\t" f[4] ", " f[3]
+            }
+            print out
+        }'
+}
+
+raw=$(loop sum_raw)
+if [ -z "$raw" ]; then
+    echo "no loop found in sum_raw"
+    exit 1
+fi
+status=0
+for fn in sum_range sum_iterator; do
+    body=$(loop $fn)
+    if [ "$body" != "$raw" ]; then
+        echo "$fn differs from the raw pointer loop:"
+        printf '%s\n' "$body"
+        status=1
+    fi
+done
+if [ $status -eq 0 ]; then
+    echo "sum_range and sum_iterator are the raw pointer loop:"
+else
+    echo "raw pointer loop:"
+fi
+printf '%s\n' "$raw"
+exit $status
@@ -0,0 +1,253 @@
+//Checks every epl::simd kernel at every level the CPU runs against plain
+//scalar loops, over lengths 0 to 200 (so every vector width's tail, and
+//its lanes plus and minus one) and a few long ones.
+//
+//  g++ -std=c++14 -O2 -I. tests/simd_test.cpp -o simd_test
+//  ./simd_test
+//
+//Integers are drawn from their whole range, so sums, dot products and
+//products wrap. Floating point data includes signed zeros, and NaNs and
+//an infinity in runs of their own. Integer results and min, max, find,
+//count, add and multiply must match the loops exactly. Floating point sums
+//and dot products must match the scalar level bit for bit and the loop to
+//within rounding. Failures are reported on stderr, and any of them makes
+//the exit status 1.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../Simd.h"
+
+namespace{
+
+    int failures = 0;
+
+    void check(bool ok, const char* what, const char* type, epl::simd::level l, uint64_t n){
+        if(!ok){
+            std::fprintf(stderr, "%s on %s at %s, n = %llu, differs from the loop\n",
+                         what, type, epl::simd::level_name(l), (unsigned long long) n);
+            failures++;
+        }
+    }
+
+    uint64_t state = 88172645463325252ull;
+    uint64_t next(void) { state ^= state << 13; state ^= state >> 7; state ^= state << 17; return state; }
+
+    /*********************element types************************************/
+    template <typename T> struct element;
+
+    template <> struct element<int32_t>{
+        static const char* name(void) { return "int32"; }
+        static int32_t make(uint64_t k){
+            switch(k % 8){
+                case 0:  return std::numeric_limits<int32_t>::max();
+                case 1:  return std::numeric_limits<int32_t>::min();
+                default: return int32_t(next());
+            }
+        }
+    };
+
+    template <> struct element<int64_t>{
+        static const char* name(void) { return "int64"; }
+        static int64_t make(uint64_t k){
+            switch(k % 8){
+                case 0:  return std::numeric_limits<int64_t>::max();
+                case 1:  return std::numeric_limits<int64_t>::min();
+                default: return int64_t(next());
+            }
+        }
+    };
+
+    template <typename F>
+    F make_real(uint64_t){
+        switch(next() % 16){
+            case 0:  return -F(0);
+            default: return F(int64_t(next() % 20001) - 10000) / F(8);
+        }
+    }
+
+    template <> struct element<float>{
+        static const char* name(void) { return "float"; }
+        static float make(uint64_t k) { return make_real<float>(k); }
+    };
+
+    template <> struct element<double>{
+        static const char* name(void) { return "double"; }
+        static double make(uint64_t k) { return make_real<double>(k); }
+    };
+
+    /*********************plain loops**************************************/
+    //integer arithmetic is done unsigned, which wraps
+    template <typename T, bool = std::is_integral<T>::value>
+    struct arith { typedef T type; };
+    template <typename T>
+    struct arith<T, true> { typedef typename std::make_unsigned<T>::type type; };
+
+    template <typename T>
+    bool same(T a, T b) { return a == b || (a != a && b != b); }
+
+    template <typename T>
+    bool bits_equal(T a, T b) { return std::memcmp(&a, &b, sizeof(T)) == 0; }
+
+    template <typename T>
+    bool close(T got, T want, T scale){
+        if(want != want) { return got != got; }
+        return std::fabs(double(got) - double(want)) <= 1e-5 * double(scale) + 1e-9;
+    }
+
+    template <typename T>
+    T loop_sum(const T* p, uint64_t n){
+        typename arith<T>::type s = 0;
+        for(uint64_t k = 0; k < n; k++) { s += typename arith<T>::type(p[k]); }
+        return T(s);
+    }
+
+    template <typename T>
+    T loop_dot(const T* a, const T* b, uint64_t n){
+        typename arith<T>::type s = 0;
+        for(uint64_t k = 0; k < n; k++) { s += typename arith<T>::type(a[k]) * typename arith<T>::type(b[k]); }
+        return T(s);
+    }
+
+    //the sum of magnitudes, against which a floating point result is judged
+    template <typename T>
+    T loop_scale(const T* a, const T* b, uint64_t n){
+        T s = 0;
+        for(uint64_t k = 0; k < n; k++) { s += std::fabs(b == nullptr ? a[k] : a[k] * b[k]); }
+        return s;
+    }
+
+    //NaNs skipped; both NaN when every element is one
+    template <typename T>
+    std::pair<T, T> loop_minmax(const T* p, uint64_t n){
+        std::pair<T, T> r(p[0], p[0]);
+        bool any = false;
+        for(uint64_t k = 0; k < n; k++){
+            if(p[k] != p[k]) { continue; }
+            if(!any || p[k] < r.first) { r.first = p[k]; }
+            if(!any || p[k] > r.second) { r.second = p[k]; }
+            any = true;
+        }
+        return r;
+    }
+
+    template <typename T>
+    uint64_t loop_find(const T* p, uint64_t n, T value){
+        for(uint64_t k = 0; k < n; k++) { if(p[k] == value) { return k; } }
+        return n;
+    }
+
+    template <typename T>
+    uint64_t loop_count(const T* p, uint64_t n, T value){
+        uint64_t c = 0;
+        for(uint64_t k = 0; k < n; k++) { if(p[k] == value) { c++; } }
+        return c;
+    }
+
+    /*********************checks*******************************************/
+    template <typename T>
+    void check_sums(const T* a, const T* b, uint64_t n, epl::simd::level l, std::true_type){
+        const char* type = element<T>::name();
+        check(epl::simd::sum(a, n, l) == loop_sum(a, n), "sum", type, l, n);
+        check(epl::simd::dot(a, b, n, l) == loop_dot(a, b, n), "dot", type, l, n);
+    }
+
+    template <typename T>
+    void check_sums(const T* a, const T* b, uint64_t n, epl::simd::level l, std::false_type){
+        const char* type = element<T>::name();
+        T s = epl::simd::sum(a, n, l), d = epl::simd::dot(a, b, n, l);
+        check(bits_equal(s, epl::simd::sum(a, n, epl::simd::SCALAR)), "sum (against scalar)", type, l, n);
+        check(bits_equal(d, epl::simd::dot(a, b, n, epl::simd::SCALAR)), "dot (against scalar)", type, l, n);
+        check(close(s, loop_sum(a, n), loop_scale(a, static_cast<const T*>(nullptr), n)), "sum", type, l, n);
+        check(close(d, loop_dot(a, b, n), loop_scale(a, b, n)), "dot", type, l, n);
+    }
+
+    template <typename T>
+    void check_level(const T* a, const T* b, uint64_t n, epl::simd::level l){
+        const char* type = element<T>::name();
+        check_sums(a, b, n, l, std::is_integral<T>());
+
+        if(n == 0){
+            bool threw = false;
+            try { epl::simd::minmax(a, n, l); }
+            catch(std::out_of_range&) { threw = true; }
+            check(threw, "minmax of nothing", type, l, n);
+        }
+        else{
+            std::pair<T, T> got = epl::simd::minmax(a, n, l), want = loop_minmax(a, n);
+            check(same(got.first, want.first) && same(got.second, want.second), "minmax", type, l, n);
+        }
+
+        //a miss, the first element, the last one and one in the middle
+        T missing = loop_sum(a, n);
+        while(loop_find(a, n, missing) != n || missing != missing) { missing = element<T>::make(next()); }
+        check(epl::simd::find(a, n, missing, l) == n, "find (miss)", type, l, n);
+        check(epl::simd::count(a, n, missing, l) == 0, "count (miss)", type, l, n);
+        uint64_t at[3] = { 0, n / 2, n - 1 };
+        for(int i = 0; i < 3 && n != 0; i++){
+            T value = a[at[i]];
+            check(epl::simd::find(a, n, value, l) == loop_find(a, n, value), "find", type, l, n);
+            check(epl::simd::count(a, n, value, l) == loop_count(a, n, value), "count", type, l, n);
+        }
+
+        T out[4200];
+        bool add_ok = true, mul_ok = true;
+        epl::simd::add(a, b, out, n, l);
+        for(uint64_t k = 0; k < n; k++) { add_ok = add_ok && same(out[k], T(typename arith<T>::type(a[k]) + typename arith<T>::type(b[k]))); }
+        epl::simd::multiply(a, b, out, n, l);
+        for(uint64_t k = 0; k < n; k++) { mul_ok = mul_ok && same(out[k], T(typename arith<T>::type(a[k]) * typename arith<T>::type(b[k]))); }
+        check(add_ok, "add", type, l, n);
+        check(mul_ok, "multiply", type, l, n);
+
+        //out aliasing a
+        T in_place[4200];
+        std::memcpy(in_place, a, sizeof(T) * n);
+        epl::simd::add(in_place, b, in_place, n, l);
+        epl::simd::add(a, b, out, n, l);
+        check(std::memcmp(in_place, out, sizeof(T) * n) == 0, "add in place", type, l, n);
+    }
+
+    template <typename T>
+    void check_type(void){
+        static T a[4200], b[4200];
+        const uint64_t lengths[] = { 1000, 1023, 1024, 1025, 4099 };
+        for(uint64_t k = 0; k < 4200; k++) { a[k] = element<T>::make(k); b[k] = element<T>::make(k + 3); }
+        for(int l = epl::simd::SCALAR; l <= epl::simd::detected(); l++){
+            for(uint64_t n = 0; n <= 200; n++) { check_level(a, b, n, epl::simd::level(l)); }
+            for(uint64_t n : lengths) { check_level(a, b, n, epl::simd::level(l)); }
+        }
+
+        //NaNs scattered, every element NaN, and NaNs leading a run of
+        //numbers with an infinity in it
+        if(!std::is_integral<T>::value){
+            T nan = std::numeric_limits<T>::quiet_NaN();
+            for(uint64_t k = 0; k < 4200; k += 7) { a[k] = nan; }
+            for(int l = epl::simd::SCALAR; l <= epl::simd::detected(); l++){
+                for(uint64_t n = 1; n <= 200; n++) { check_level(a, b, n, epl::simd::level(l)); }
+                for(uint64_t n : lengths) { check_level(a, b, n, epl::simd::level(l)); }
+            }
+            for(uint64_t k = 0; k < 200; k++) { a[k] = nan; }
+            for(int l = epl::simd::SCALAR; l <= epl::simd::detected(); l++){
+                for(uint64_t n = 1; n <= 200; n++) { check_level(a, b, n, epl::simd::level(l)); }
+                a[150] = T(-2.5); a[170] = std::numeric_limits<T>::infinity();
+                for(uint64_t n = 151; n <= 200; n++) { check_level(a, b, n, epl::simd::level(l)); }
+                a[150] = a[170] = nan;
+            }
+        }
+    }
+
+} //namespace
+
+int main(void){
+    check_type<int32_t>();
+    check_type<int64_t>();
+    check_type<float>();
+    check_type<double>();
+    std::printf("%d failures (levels up to %s)\n", failures, epl::simd::level_name(epl::simd::detected()));
+    return failures == 0 ? 0 : 1;
+}